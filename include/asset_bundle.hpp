@@ -0,0 +1,33 @@
+#pragma once
+#include "model.hpp"
+#include <string>
+#include <vector>
+
+namespace MCPSP {
+
+// Block models compiled ahead of time by tools/asset_compiler, so that the
+// PSP can register blocks without reading or parsing any JSON.
+//
+// A bundle holds a string table, every model with its parents merged in and
+// its texture variables resolved, and the model each block uses. Models
+// shared by several blocks are stored once.
+struct AssetBundle {
+  static constexpr uint32_t VERSION = 1;
+
+  struct BlockEntry {
+    std::string block;
+    std::size_t model; // Index into models
+  };
+
+  std::vector<Model> models;
+  std::vector<BlockEntry> blocks;
+
+  // Throws if the file can't be read or isn't a bundle of this version
+  static AssetBundle read(const std::string &path);
+  void write(const std::string &path) const;
+
+  // Resolves the model's texture variables, making it storable in a bundle
+  static Model flatten(const Model &model);
+};
+
+} // namespace MCPSP
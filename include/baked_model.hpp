@@ -0,0 +1,82 @@
+#pragma once
+#include "direction.hpp"
+#include "model.hpp"
+#include "raylib.h"
+#include "resource_location.hpp"
+#include "texture_atlas.hpp"
+#include "texture_manager.hpp"
+#include <cstdint>
+#include <vector>
+
+namespace MCPSP {
+
+// Component of v along axis 0 (X), 1 (Y) or 2 (Z).
+inline float getComponent(Vector3 v, int axis) {
+  return axis == 0 ? v.x : (axis == 1 ? v.y : v.z);
+}
+
+// A single model face with everything the mesher needs already resolved.
+// Corners are in block space (0-1) with element rotation applied and are
+// wound so that (0, 1, 2) and (0, 2, 3) form the two triangles of the face.
+//
+// texture and uvs refer to the source texture. atlasPage and atlasUvs are what
+// the quad is drawn with; they match the source until the atlas is stitched.
+// The handles are resolved alongside them so meshes can be keyed by handle,
+// and the layer comes from the source texture's alpha channel.
+struct BakedQuad {
+  Vector3 corners[4];
+  Vector2 uvs[4];
+  ResourceLocation texture = ResourceLocation::fromId(ResourceLocation::AIR_ID);
+  ResourceLocation atlasPage =
+      ResourceLocation::fromId(ResourceLocation::AIR_ID);
+  Vector2 atlasUvs[4];
+  TextureHandle textureHandle = 0;
+  TextureHandle atlasHandle = 0;
+  RenderLayer layer = RenderLayer::Solid;
+  int8_t tintIndex = -1;
+  Direction face = Direction::None;
+  Direction cullface = Direction::None;
+};
+
+// Flat list of quads built once from a Model, so that meshing needs no string
+// comparisons, matrix math or texture variable lookups.
+class BakedModel {
+  std::vector<BakedQuad> quads;
+  // Bounds of each element in block space, for picking
+  std::vector<BoundingBox> boxes;
+  // Bit per Direction, see isFullFace
+  uint8_t fullFaces = 0;
+  bool cullable = false;
+  bool opaque = false;
+
+  bool computeFullFace(Direction face) const;
+
+public:
+  BakedModel() = default;
+  explicit BakedModel(const Model &model);
+
+  const std::vector<BakedQuad> &getQuads() const { return quads; }
+  // Rotated elements are bounded by their rotated corners
+  const std::vector<BoundingBox> &getBoxes() const { return boxes; }
+
+  // True if every quad on this side is an unrotated face covering the whole
+  // side of the block, culled by its neighbour and mapping the whole texture.
+  // Such faces can be merged with identical neighbours by the greedy mesher.
+  bool isFullFace(Direction face) const {
+    return fullFaces & (1 << static_cast<int>(face));
+  }
+
+  // True if every quad has a cullface, so the block produces no geometry once
+  // all of its neighbours are solid.
+  bool isCullable() const { return cullable; }
+
+  // True if all six sides are full faces and every quad is in the solid
+  // layer, so nothing can be seen through the block. Full cubes of glass or
+  // leaves let light and sight through their transparent texels.
+  bool isOpaque() const { return opaque; }
+
+  // Points every quad at its region of the atlas.
+  void remapToAtlas(const TextureAtlas &atlas);
+};
+
+} // namespace MCPSP
@@ -1,11 +1,25 @@
 #pragma once
+#include "baked_model.hpp"
 #include "model.hpp"
 
 namespace MCPSP {
 
+class Chunk;
+class World;
+
+// Runs a scheduled tick of the block at (x, y, z), in chunk coordinates
+using BlockTickCallback = void (*)(World &world, Chunk &chunk, int x, int y,
+                                   int z);
+
 class Block {
 public:
   Model model;
+  // Filled in from model by BlockRegistry::registerBlock
+  BakedModel bakedModel;
+  // Block light level given off, from 0 to 15
+  uint8_t lightEmission = 0;
+  // Ticks scheduled for blocks without a callback do nothing
+  BlockTickCallback onScheduledTick = nullptr;
 };
 
 } // namespace MCPSP
@@ -1,21 +1,43 @@
 #pragma once
 #include "block.hpp"
 #include "resource_location.hpp"
-#include <unordered_map>
+#include "texture_atlas.hpp"
+#include <cstdint>
 #include <string>
+#include <vector>
 
 namespace MCPSP {
 
 class BlockRegistry {
-  static std::unordered_map<ResourceLocation, Block> blocks;
+  // Dense block storage. Slot 0 holds an empty block (air), which is also
+  // returned for locations that were never registered.
+  static std::vector<Block> blocks;
+  // Block slot for each interned ResourceLocation ID, or 0 if unregistered.
+  static std::vector<uint16_t> slots;
+  static TextureAtlas atlas;
 
 public:
   static void registerBlock(const ResourceLocation &location,
                             const Block &block);
-  static const Block &getBlock(const ResourceLocation &location);
-  static const std::unordered_map<ResourceLocation, Block> &getBlocks() {
-    return blocks;
+  // Registers every block in an asset bundle built by tools/asset_compiler
+  static void registerBundle(const std::string &path);
+
+  static const Block &getBlock(const ResourceLocation &location) noexcept {
+    uint16_t id = location.getId();
+    return blocks[id < slots.size() ? slots[id] : 0];
+  }
+
+  static bool isRegistered(const ResourceLocation &location) {
+    uint16_t id = location.getId();
+    return id < slots.size() && slots[id] != 0;
   }
+
+  static const std::vector<Block> &getBlocks() { return blocks; }
+
+  // Packs the textures of all registered blocks into the block atlas and
+  // remaps their baked quads to it. Call once every block is registered.
+  static void stitchTextures();
+  static const TextureAtlas &getAtlas() { return atlas; }
 };
 
 } // namespace MCPSP
@@ -0,0 +1,106 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace MCPSP {
+
+// Appends little-endian values to a byte vector, for the on-disk formats.
+class ByteWriter {
+  std::vector<uint8_t> &out;
+
+public:
+  explicit ByteWriter(std::vector<uint8_t> &out) : out(out) {}
+
+  void u8(uint8_t value) { out.push_back(value); }
+
+  void u16(uint16_t value) {
+    out.push_back(static_cast<uint8_t>(value));
+    out.push_back(static_cast<uint8_t>(value >> 8));
+  }
+
+  void u32(uint32_t value) {
+    u16(static_cast<uint16_t>(value));
+    u16(static_cast<uint16_t>(value >> 16));
+  }
+
+  void i8(int8_t value) { u8(static_cast<uint8_t>(value)); }
+
+  void i16(int16_t value) { u16(static_cast<uint16_t>(value)); }
+
+  // Written bit for bit, so values read back compare equal
+  void f32(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    u32(bits);
+  }
+
+  // Length-prefixed, up to 255 bytes
+  void string(const std::string &value) {
+    if (value.size() > UINT8_MAX) {
+      throw std::runtime_error("string too long to write: " + value);
+    }
+    u8(static_cast<uint8_t>(value.size()));
+    out.insert(out.end(), value.begin(), value.end());
+  }
+};
+
+// Reads values written by ByteWriter. Throws if the data runs out, so
+// truncated files are reported instead of read past.
+class ByteReader {
+  const uint8_t *data;
+  const uint8_t *end;
+
+  void require(std::size_t bytes) const {
+    if (static_cast<std::size_t>(end - data) < bytes) {
+      throw std::runtime_error("unexpected end of data");
+    }
+  }
+
+public:
+  ByteReader(const uint8_t *data, std::size_t size)
+      : data(data), end(data + size) {}
+
+  bool atEnd() const { return data == end; }
+
+  uint8_t u8() {
+    require(1);
+    return *data++;
+  }
+
+  uint16_t u16() {
+    require(2);
+    uint16_t value = static_cast<uint16_t>(data[0] | data[1] << 8);
+    data += 2;
+    return value;
+  }
+
+  uint32_t u32() {
+    uint32_t low = u16();
+    return low | static_cast<uint32_t>(u16()) << 16;
+  }
+
+  int8_t i8() { return static_cast<int8_t>(u8()); }
+
+  int16_t i16() { return static_cast<int16_t>(u16()); }
+
+  float f32() {
+    uint32_t bits = u32();
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+  }
+
+  std::string string() {
+    std::size_t length = u8();
+    require(length);
+    std::string value(reinterpret_cast<const char *>(data), length);
+    data += length;
+    return value;
+  }
+};
+
+} // namespace MCPSP
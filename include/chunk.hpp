@@ -1,5 +1,10 @@
 #pragma once
 #include "block.hpp"
+#include "chunk_mesher.hpp"
+#include "chunk_section.hpp"
+#include "chunk_vertex.hpp"
+#include "direction.hpp"
+#include "frustum.hpp"
 #include "raylib.h"
 #include "resource_location.hpp"
 #include <array>
@@ -10,52 +15,197 @@ namespace MCPSP {
 
 class World;
 
-struct Mesh {
-  std::vector<Vector3> vertices;
-  std::vector<Vector2> uvs;
-  std::vector<Color> colors;
+// What a frame submitted to the GE, and what frustum culling saved
+struct DrawStats {
+  unsigned chunksDrawn = 0;
+  unsigned chunksCulled = 0;
+  unsigned sectionsDrawn = 0;
+  unsigned sectionsCulled = 0;
+  // Sections inside the frustum but hidden behind opaque blocks
+  unsigned sectionsOccluded = 0;
+  std::size_t trianglesDrawn = 0;
+  std::size_t trianglesCulled = 0;
+  std::size_t trianglesOccluded = 0;
+  // Work done submitting the frame's render list
+  unsigned drawCalls = 0;
+  unsigned textureBinds = 0;
+  unsigned stateChanges = 0;
 };
 
-struct BlockState {
-  ResourceLocation block = ResourceLocation("minecraft:air");
-};
+class MeshWorker;
+struct MeshResult;
+class RenderList;
 
 class Chunk {
+public:
+  // The world height is only limited by SECTION_COUNT, since meshes are
+  // relative to their section.
+  static constexpr int SECTION_COUNT = 4;
+  static constexpr int HEIGHT = SECTION_COUNT * ChunkSection::SIZE;
+  static_assert(SECTION_COUNT <= 32, "sections must fit in a 32-bit mask");
+
+private:
+  static MeshingMode meshingMode;
+
   World *world;
-  std::array<std::array<std::array<BlockState, 16>, 64>, 16> blocks;
+  std::array<ChunkSection, SECTION_COUNT> sections;
 
   // Position of this chunk in the world grid
   int chunkX;
   int chunkZ;
 
-  std::unordered_map<std::string, Mesh> meshes;
-  bool dirty = true;
+  // Set by edits since the chunk was generated, loaded or saved
+  bool modified = false;
 
-  void generateMesh();
-  void generateBlockMesh(const BlockState &blockState, Vector3 position);
+  bool isSectionEnclosed(int sectionY) const;
+  SectionSnapshot takeSnapshot(int sectionY) const;
 
 public:
   Chunk() = default;
   Chunk(World *world, int chunkX, int chunkZ)
       : world(world), chunkX(chunkX), chunkZ(chunkZ) {};
 
+  // Marks the section holding the block dirty, along with the neighbouring
+  // sections whose meshes see it (see markBlockDirty).
+  void setBlock(int x, int y, int z, const BlockState &state);
+
   void setBlock(int x, int y, int z, const ResourceLocation &block) {
-    blocks[x][y][z].block = block;
-    dirty = true;
+    setBlock(x, y, z, BlockState{block});
+  }
+
+  // Writes a block without marking neighbours dirty or the chunk modified,
+  // for filling in new chunks. The caller updates the neighbours once done.
+  void setGeneratedBlock(int x, int y, int z, const BlockState &state) {
+    sections[y / ChunkSection::SIZE].setBlock(x, y % ChunkSection::SIZE, z,
+                                              state);
   }
 
   BlockState getBlock(int x, int y, int z) const {
-    if (x >= 0 && x < 16 && y >= 0 && y < 64 && z >= 0 && z < 16) {
-      return blocks[x][y][z];
+    if (x >= 0 && x < 16 && y >= 0 && y < HEIGHT && z >= 0 && z < 16) {
+      return sections[y / ChunkSection::SIZE].getBlock(
+          x, y % ChunkSection::SIZE, z);
     }
     return BlockState(); // Returns air by default
   }
 
+  // Cheaper than comparing getBlock() against air, as it only reads the
+  // packed palette index.
+  bool isAir(int x, int y, int z) const {
+    if (x >= 0 && x < 16 && y >= 0 && y < HEIGHT && z >= 0 && z < 16) {
+      return sections[y / ChunkSection::SIZE].isAir(x, y % ChunkSection::SIZE,
+                                                    z);
+    }
+    return true;
+  }
+
+  // Outside the chunk, sky light is full and block light is dark.
+  uint8_t getLight(LightChannel channel, int x, int y, int z) const {
+    if (x >= 0 && x < 16 && y >= 0 && y < HEIGHT && z >= 0 && z < 16) {
+      return sections[y / ChunkSection::SIZE].getLight(
+          channel, ChunkSection::blockIndex(x, y % ChunkSection::SIZE, z));
+    }
+    return channel == LightChannel::Sky ? 15 : 0;
+  }
+
+  // Only for the LightEngine, which marks the affected sections dirty
+  void setLight(LightChannel channel, int x, int y, int z, uint8_t level) {
+    sections[y / ChunkSection::SIZE].setLight(
+        channel, ChunkSection::blockIndex(x, y % ChunkSection::SIZE, z),
+        level);
+  }
+  void resetLight(LightChannel channel, int sectionY, uint8_t level) {
+    sections[sectionY].resetLight(channel, level);
+  }
+
+  bool isModified() const { return modified; }
+  void markModified() { modified = true; }
+  void clearModified() { modified = false; }
+
+  // Saves or loads the blocks of every section and the chunk's scheduled
+  // ticks, for region files. read() expects a freshly constructed chunk and
+  // throws on malformed data.
+  void write(ByteWriter &out) const;
+  void read(ByteReader &in);
+
+  const ChunkSection &getSection(int sectionY) const {
+    return sections[sectionY];
+  }
+
+  // Bytes used by block storage, and what a flat BlockState array would need.
+  std::size_t getMemoryUsage() const {
+    std::size_t bytes = 0;
+    for (const ChunkSection &section : sections) {
+      bytes += section.getMemoryUsage();
+    }
+    return bytes;
+  }
+  static constexpr std::size_t getUnpackedMemoryUsage() {
+    return 16 * HEIGHT * 16 * sizeof(BlockState);
+  }
+
+  static MeshingMode getMeshingMode() { return meshingMode; }
+  // Takes effect the next time a chunk is remeshed
+  static void setMeshingMode(MeshingMode mode) { meshingMode = mode; }
+
+  void markDirty() {
+    for (ChunkSection &section : sections) {
+      section.dirty = true;
+    }
+  }
+
+  void markSectionDirty(int sectionY) {
+    if (sectionY >= 0 && sectionY < SECTION_COUNT) {
+      sections[sectionY].dirty = true;
+    }
+  }
+
+  // Marks the section holding the block dirty. Meshes read a block of
+  // padding on every side for culling, ambient occlusion and light, so a
+  // block on a border also dirties every section across it, diagonals
+  // included.
+  void markBlockDirty(int x, int y, int z);
+
+  bool isSectionDirty(int sectionY) const { return sections[sectionY].dirty; }
+
+  std::size_t getVertexCount() const {
+    std::size_t count = 0;
+    for (const ChunkSection &section : sections) {
+      count += section.getVertexCount();
+    }
+    return count;
+  }
+
+  std::size_t getVertexBytes() const {
+    return getVertexCount() * sizeof(ChunkVertex);
+  }
+
+  bool needsMeshing() const {
+    for (const ChunkSection &section : sections) {
+      if (section.dirty && section.meshTicket == 0) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Submits dirty sections that aren't already being meshed, up to budget
+  // jobs. Sections left over stay dirty for the next call.
+  void queueMeshing(MeshWorker &worker, uint32_t &nextTicket, int &budget);
+  // Swaps in a finished mesh. Returns false if the result is stale.
+  bool applyMesh(MeshResult &result);
+  // Drops every mesh along with its texture references, before unloading.
+  void releaseMeshes();
+
   // Get chunk position
   int getChunkX() const { return chunkX; }
   int getChunkZ() const { return chunkZ; }
 
-  void draw(const Vector3 &position);
+  // Adds the meshes of sections inside the frustum whose bit is set in
+  // reachable to list. The caller is expected to have culled the chunk as a
+  // whole already.
+  void queueDraws(const Vector3 &position, const Frustum &frustum,
+                  uint32_t reachable, const Vector3 &camera, RenderList &list,
+                  DrawStats &stats) const;
 };
 
 } // namespace MCPSP
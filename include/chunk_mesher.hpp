@@ -0,0 +1,105 @@
+#pragma once
+#include "block.hpp"
+#include "chunk_section.hpp"
+#include "direction.hpp"
+#include "section_visibility.hpp"
+#include <cstdint>
+#include <vector>
+
+namespace MCPSP {
+
+// Naive meshing emits every visible face on its own. Greedy meshing merges
+// adjacent full-cube faces of the same block into larger quads, which are
+// drawn from the block's own texture with repeat wrapping instead of the atlas.
+enum class MeshingMode { Naive, Greedy };
+
+// Immutable copy of everything needed to mesh one section, so that meshing
+// can run off the main thread while the chunk keeps changing.
+//
+// Blocks are stored as indices into a snapshot-local palette, padded with one
+// layer of blocks from the surrounding sections (including diagonal ones) so
+// that any neighbour of a block in the section is a fixed offset away.
+// Padding from unloaded chunks or from beyond the world is air.
+//
+// Light is padded the same way, and is full sky light where there is no
+// section to copy it from.
+struct SectionSnapshot {
+  static constexpr int PADDED_SIZE = ChunkSection::SIZE + 2;
+  static constexpr int PADDED_VOLUME = PADDED_SIZE * PADDED_SIZE * PADDED_SIZE;
+
+  // Palette index 0 is always air
+  std::vector<uint16_t> cells = std::vector<uint16_t>(PADDED_VOLUME, 0);
+  std::vector<BlockState> palette{BlockState()};
+  // Sky light in the high nibble, block light in the low one
+  std::vector<uint8_t> light = std::vector<uint8_t>(PADDED_VOLUME, 0xF0);
+  // Set when the section is opaque and buried in solid sections, in which
+  // case it has no visible faces at all
+  bool enclosed = false;
+  MeshingMode mode = MeshingMode::Naive;
+
+  // Takes section-local coordinates, from -1 to ChunkSection::SIZE
+  static int cellIndex(int x, int y, int z) {
+    return ((y + 1) * PADDED_SIZE + (z + 1)) * PADDED_SIZE + (x + 1);
+  }
+
+  // Offset between a cell and its neighbour in the given direction
+  static int cellOffset(Direction direction) {
+    DirectionOffset offset = getOffset(direction);
+    return (offset.y * PADDED_SIZE + offset.z) * PADDED_SIZE + offset.x;
+  }
+
+  // Copies the part of a section that falls within the padded snapshot.
+  // (dx, dy, dz) is the position of the source relative to the snapshot's
+  // section, each from -1 to 1.
+  void copyFrom(const ChunkSection &source, int dx, int dy, int dz);
+  // Same as copyFrom, for the light
+  void copyLightFrom(const ChunkSection &source, int dx, int dy, int dz);
+};
+
+// Builds section meshes from snapshots. Only reads the snapshot and the
+// BlockRegistry, so it is safe to use from a worker thread once all blocks
+// are registered.
+class ChunkMesher {
+  const SectionSnapshot &snapshot;
+  std::vector<const Block *> paletteBlocks;
+  std::vector<bool> paletteOpaque;
+  MeshSet meshes;
+
+  int faceOffsets[6];
+  // Offset between neighbouring cells along x, y and z
+  int axisOffsets[3];
+
+  bool isFaceCulled(int cell, Direction face) const {
+    return snapshot.cells[cell + faceOffsets[static_cast<int>(face)]] != 0;
+  }
+  bool isOpaque(int cell) const { return paletteOpaque[snapshot.cells[cell]]; }
+
+  // Brightness of a quad corner from 0 to 255: the light of the blocks the
+  // corner touches on the lit side of the face, darkened by ambient
+  // occlusion from the opaque ones. corner is relative to the block.
+  uint8_t computeShade(int cell, Direction face, const Vector3 &corner) const;
+
+  // Adds a quad of the block at (x, y, z) from the atlas, shaded per corner
+  void addBlockQuad(const BakedQuad &quad, int x, int y, int z);
+  void generateBlockMesh(const Block &block, int x, int y, int z);
+  void generateGreedyMesh();
+
+  explicit ChunkMesher(const SectionSnapshot &snapshot) : snapshot(snapshot) {
+    for (int face = 0; face < 6; ++face) {
+      faceOffsets[face] =
+          SectionSnapshot::cellOffset(static_cast<Direction>(face));
+    }
+    axisOffsets[0] = SectionSnapshot::cellOffset(Direction::East);
+    axisOffsets[1] = SectionSnapshot::cellOffset(Direction::Up);
+    axisOffsets[2] = SectionSnapshot::cellOffset(Direction::South);
+  }
+
+public:
+  static MeshSet generate(const SectionSnapshot &snapshot);
+
+  // Flood fills the non-opaque blocks of the section to find which of its
+  // faces can see each other.
+  static SectionVisibility computeVisibility(const SectionSnapshot &snapshot);
+};
+
+} // namespace MCPSP
@@ -0,0 +1,22 @@
+#pragma once
+#include <functional>
+
+namespace MCPSP {
+
+struct ChunkPosition {
+  int x, z;
+
+  bool operator==(const ChunkPosition &other) const {
+    return x == other.x && z == other.z;
+  }
+};
+
+} // namespace MCPSP
+
+namespace std {
+template <> struct hash<MCPSP::ChunkPosition> {
+  std::size_t operator()(const MCPSP::ChunkPosition &pos) const noexcept {
+    return std::hash<int>()(pos.x) ^ (std::hash<int>()(pos.z) << 1);
+  }
+};
+} // namespace std
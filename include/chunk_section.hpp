@@ -0,0 +1,132 @@
+#pragma once
+#include "byte_buffer.hpp"
+#include "chunk_vertex.hpp"
+#include "nibble_array.hpp"
+#include "paletted_container.hpp"
+#include "render_layer.hpp"
+#include "resource_location.hpp"
+#include "section_visibility.hpp"
+#include "texture_manager.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace MCPSP {
+
+// Indexed quads, 4 vertices per face. See getQuadIndices.
+struct Mesh {
+  std::vector<ChunkVertex> vertices;
+};
+
+// Meshes of one layer keyed by the texture they are drawn with
+using LayerMeshes = std::unordered_map<TextureHandle, Mesh>;
+// Meshes of a section, indexed by RenderLayer
+using MeshSet = std::array<LayerMeshes, RENDER_LAYER_COUNT>;
+
+// Sky light comes down from the top of the world, block light from emitting
+// blocks such as torches. Both range from 0 to 15.
+enum class LightChannel : uint8_t { Sky, Block };
+
+struct BlockState {
+  ResourceLocation block = ResourceLocation::fromId(ResourceLocation::AIR_ID);
+
+  bool operator==(const BlockState &other) const {
+    return block == other.block;
+  }
+};
+
+// A 16x16x16 cube of blocks within a chunk, meshed and drawn on its own so
+// that edits only remesh the part of the chunk they touch.
+class ChunkSection {
+  // Palette index 0 is always air, since every section starts out empty.
+  PalettedContainer<BlockState> blocks{SIZE * SIZE * SIZE, BlockState()};
+
+  // Number of non-air blocks, and of blocks that are hidden once surrounded
+  // (see BakedModel::isCullable)
+  int nonAirCount = 0;
+  int cullableCount = 0;
+
+  // Written by the LightEngine. Uniformly lit sections, such as those open
+  // to the sky, store no packed light.
+  NibbleArray skyLight{VOLUME, 0};
+  NibbleArray blockLight{VOLUME, 0};
+
+public:
+  static constexpr int SIZE = 16;
+  static constexpr int VOLUME = SIZE * SIZE * SIZE;
+
+  // Vertex positions are relative to the section origin. These are the
+  // meshes being drawn; rebuilt ones are swapped in with setMeshes once they
+  // are ready.
+  MeshSet meshes;
+  bool dirty = true;
+  // Ticket of the meshing job in flight for this section, or 0 if there is
+  // none
+  uint32_t meshTicket = 0;
+  // Computed alongside the mesh, so it also lags behind edits until the
+  // rebuilt mesh is applied
+  SectionVisibility visibility;
+
+  static std::size_t blockIndex(int x, int y, int z) {
+    return (y * SIZE + z) * SIZE + x;
+  }
+
+  const PalettedContainer<BlockState> &getBlocks() const { return blocks; }
+
+  // Returns false if the block was already there.
+  bool setBlock(int x, int y, int z, const BlockState &state);
+
+  const BlockState &getBlock(int x, int y, int z) const {
+    return blocks.get(blockIndex(x, y, z));
+  }
+
+  bool isAir(int x, int y, int z) const {
+    return blocks.getIndex(blockIndex(x, y, z)) == 0;
+  }
+
+  bool isAllAir() const { return nonAirCount == 0; }
+  bool isAllSolid() const { return nonAirCount == VOLUME; }
+  // Every block is hidden once surrounded by solid blocks, which doesn't make
+  // it opaque to light (see BakedModel::isCullable)
+  bool isAllCullable() const { return cullableCount == VOLUME; }
+
+  uint8_t getLight(LightChannel channel, std::size_t index) const {
+    return channel == LightChannel::Sky ? skyLight.get(index)
+                                        : blockLight.get(index);
+  }
+  void setLight(LightChannel channel, std::size_t index, uint8_t level) {
+    (channel == LightChannel::Sky ? skyLight : blockLight).set(index, level);
+  }
+  // Sets the whole section to one light level
+  void resetLight(LightChannel channel, uint8_t level) {
+    (channel == LightChannel::Sky ? skyLight : blockLight).reset(level);
+  }
+
+  std::size_t getMemoryUsage() const {
+    return blocks.getMemoryUsage() + skyLight.getMemoryUsage() +
+           blockLight.getMemoryUsage();
+  }
+
+  // Replaces the meshes, moving the texture references over to the new ones.
+  void setMeshes(MeshSet &&replacement);
+
+  // Saves the blocks as the palette followed by runs of palette indices.
+  void write(ByteWriter &out) const;
+  // Loads blocks saved by write() into an empty section. Throws on
+  // malformed data.
+  void read(ByteReader &in);
+
+  std::size_t getVertexCount() const {
+    std::size_t count = 0;
+    for (const LayerMeshes &layer : meshes) {
+      for (const auto &[texture, mesh] : layer) {
+        count += mesh.vertices.size();
+      }
+    }
+    return count;
+  }
+};
+
+} // namespace MCPSP
@@ -0,0 +1,70 @@
+#pragma once
+#include "chunk_position.hpp"
+#include "raylib.h"
+#include <cstddef>
+#include <cstdint>
+#include <queue>
+#include <unordered_map>
+#include <vector>
+
+namespace MCPSP {
+
+class World;
+
+// Loads chunks around the camera and unloads them once it moves away. Saved
+// chunks are loaded from the world's region files, the rest are generated.
+//
+// Chunks within the load radius are generated nearest first, a few per
+// frame. Chunks beyond the unload radius are always dropped. Between the two
+// radii chunks are kept until the world goes over its memory budget, at which
+// point the ones the camera left longest ago are dropped first.
+class ChunkStreamer {
+  struct Request {
+    int distance; // Squared, in chunks
+    ChunkPosition position;
+
+    bool operator>(const Request &other) const {
+      return distance > other.distance;
+    }
+  };
+
+  World &world;
+  int loadRadius = 4;
+  int unloadRadius = 6;
+  int generateBudget = 1;
+  std::size_t memoryBudget = 6 * 1024 * 1024;
+
+  std::priority_queue<Request, std::vector<Request>, std::greater<Request>>
+      requests;
+  // Last update each loaded chunk was within the load radius
+  std::unordered_map<ChunkPosition, uint32_t> lastUsed;
+  uint32_t updateCount = 0;
+
+  ChunkPosition center{0, 0};
+  bool hasCenter = false;
+
+  void queueRequests();
+  void evict();
+
+public:
+  explicit ChunkStreamer(World &world) : world(world) {}
+
+  // Radii are in chunks. The unload radius should be larger than the load
+  // radius, so that chunks on the edge aren't reloaded as the camera wobbles.
+  void setRadii(int load, int unload) {
+    loadRadius = load;
+    unloadRadius = unload;
+    hasCenter = false;
+  }
+  // Chunks generated per update at most
+  void setGenerateBudget(int budget) { generateBudget = budget; }
+  void setMemoryBudget(std::size_t bytes) { memoryBudget = bytes; }
+
+  // Call once per frame, before World::update.
+  void update(const Vector3 &camera);
+
+  // Chunks within the load radius still waiting to be generated
+  std::size_t getPendingCount() const { return requests.size(); }
+};
+
+} // namespace MCPSP
@@ -0,0 +1,66 @@
+#pragma once
+#include "raylib.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+namespace MCPSP {
+
+// Interleaved chunk vertex laid out in the order the PSP's GE reads vertex
+// attributes (texture, color, position), so it can be handed over as-is.
+//
+// Positions are fixed point relative to the section origin and UVs are fixed
+// point in texture space; the scale factors are applied by the modelview and
+// texture matrices when drawing.
+struct ChunkVertex {
+  int16_t u, v;
+  Color color;
+  int16_t x, y, z;
+  int16_t padding; // Keeps the stride a multiple of 4 bytes, as the GE wants
+};
+
+static_assert(sizeof(ChunkVertex) == 16, "ChunkVertex must stay packed");
+
+// 1/256 of a block, enough for 1/16 model pixels and rotated elements, with
+// room for positions up to 127 blocks from the origin.
+constexpr float VERTEX_POSITION_SCALE = 256.0f;
+// 1/256 of a texture, which is exactly one texel of an atlas page, with room
+// for repeated textures spanning up to 127 tiles.
+constexpr float VERTEX_UV_SCALE = 256.0f;
+
+inline int16_t encodeFixed(float value, float scale) {
+  long fixed = std::lround(value * scale);
+  return static_cast<int16_t>(std::clamp(fixed, -32768L, 32767L));
+}
+
+inline ChunkVertex encodeVertex(Vector3 position, Vector2 uv, Color color) {
+  ChunkVertex vertex;
+  vertex.u = encodeFixed(uv.x, VERTEX_UV_SCALE);
+  vertex.v = encodeFixed(uv.y, VERTEX_UV_SCALE);
+  vertex.color = color;
+  vertex.x = encodeFixed(position.x, VERTEX_POSITION_SCALE);
+  vertex.y = encodeFixed(position.y, VERTEX_POSITION_SCALE);
+  vertex.z = encodeFixed(position.z, VERTEX_POSITION_SCALE);
+  vertex.padding = 0;
+  return vertex;
+}
+
+inline void decodeVertex(const ChunkVertex &vertex, Vector3 &position,
+                         Vector2 &uv, Color &color) {
+  position = {vertex.x / VERTEX_POSITION_SCALE,
+              vertex.y / VERTEX_POSITION_SCALE,
+              vertex.z / VERTEX_POSITION_SCALE};
+  uv = {vertex.u / VERTEX_UV_SCALE, vertex.v / VERTEX_UV_SCALE};
+  color = vertex.color;
+}
+
+// Quads are stored as 4 vertices each and drawn with a shared index buffer
+// that splits every quad into the triangles (0, 1, 2) and (0, 2, 3). 16-bit
+// indices cover at most QUAD_BATCH_SIZE quads per draw call.
+constexpr std::size_t QUAD_BATCH_SIZE = 65536 / 4;
+
+// Returns the shared index buffer, QUAD_BATCH_SIZE * 6 indices long.
+const uint16_t *getQuadIndices();
+
+} // namespace MCPSP
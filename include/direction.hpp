@@ -0,0 +1,80 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+namespace MCPSP {
+
+enum class Direction : uint8_t { North, South, East, West, Up, Down, None };
+
+// Parses a model face name ("north", "up", ...). Returns Direction::None for
+// anything else, including the empty string.
+inline Direction parseDirection(const std::string &name) {
+  if (name == "north")
+    return Direction::North;
+  if (name == "south")
+    return Direction::South;
+  if (name == "east")
+    return Direction::East;
+  if (name == "west")
+    return Direction::West;
+  if (name == "up")
+    return Direction::Up;
+  if (name == "down")
+    return Direction::Down;
+  return Direction::None;
+}
+
+// Inverse of parseDirection. Direction::None has an empty name.
+inline const char *getName(Direction direction) {
+  static const char *const names[] = {"north", "south", "east", "west",
+                                      "up",    "down",  ""};
+  return names[static_cast<int>(direction)];
+}
+
+// Unit offset of the neighbouring block in each direction.
+struct DirectionOffset {
+  int x, y, z;
+};
+
+inline DirectionOffset getOffset(Direction direction) {
+  static const DirectionOffset offsets[] = {
+      {0, 0, -1}, // North
+      {0, 0, 1},  // South
+      {1, 0, 0},  // East
+      {-1, 0, 0}, // West
+      {0, 1, 0},  // Up
+      {0, -1, 0}, // Down
+      {0, 0, 0},  // None
+  };
+  return offsets[static_cast<int>(direction)];
+}
+
+// Axis a direction runs along: 0 for X, 1 for Y, 2 for Z.
+inline int getAxis(Direction direction) {
+  switch (direction) {
+  case Direction::East:
+  case Direction::West:
+    return 0;
+  case Direction::Up:
+  case Direction::Down:
+    return 1;
+  default:
+    return 2;
+  }
+}
+
+inline Direction getOpposite(Direction direction) {
+  static const Direction opposites[] = {
+      Direction::South, Direction::North, Direction::West, Direction::East,
+      Direction::Down,  Direction::Up,    Direction::None,
+  };
+  return opposites[static_cast<int>(direction)];
+}
+
+// True for directions pointing along the positive axis.
+inline bool isPositive(Direction direction) {
+  return direction == Direction::South || direction == Direction::East ||
+         direction == Direction::Up;
+}
+
+} // namespace MCPSP
@@ -0,0 +1,20 @@
+#pragma once
+#include "raylib.h"
+
+namespace MCPSP {
+
+// The six clipping planes of a camera's view volume, used to skip geometry
+// that can't end up on screen before any GL state is touched.
+class Frustum {
+  // Plane normals point into the frustum, with the distance in w
+  Vector4 planes[6];
+
+public:
+  // Matches the projection BeginMode3D sets up for perspective cameras
+  Frustum(const Camera3D &camera, float aspect);
+
+  // Conservative: boxes that straddle a plane count as visible
+  bool isBoxVisible(const Vector3 &min, const Vector3 &max) const;
+};
+
+} // namespace MCPSP
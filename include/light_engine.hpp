@@ -0,0 +1,80 @@
+#pragma once
+#include "chunk_section.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace MCPSP {
+
+class Chunk;
+class World;
+
+// Flood fills sky and block light through the loaded chunks with breadth
+// first queues. Light drops by one level per block and doesn't enter opaque
+// blocks, except that full sky light travels straight down undimmed.
+//
+// Edits only relight the blocks whose light came through or from the edited
+// block: its light is first removed along with everything that depended on
+// it, then refilled from the edges of the cleared region.
+//
+// Sections whose light changed (or whose meshes sample it, across section
+// and chunk borders) are marked dirty.
+class LightEngine {
+  struct Node {
+    int x, y, z;
+    uint8_t level;
+  };
+
+  World &world;
+  std::vector<Node> propagation;
+  std::vector<Node> removal;
+
+  // Chunk lit by initChunk, which needs no dirty marking as it is new
+  const Chunk *initializing = nullptr;
+  // Chunk being unloaded, treated as if it were already gone
+  const Chunk *unloading = nullptr;
+  // Most steps stay within one chunk, so the last lookup is kept. Only valid
+  // during a single call, as chunks may be unloaded in between.
+  Chunk *cachedChunk = nullptr;
+  int cachedX = 0;
+  int cachedZ = 0;
+
+  unsigned chunksLit = 0;
+  double initSeconds = 0.0;
+  unsigned relights = 0;
+  double relightSeconds = 0.0;
+  double lastRelightSeconds = 0.0;
+
+  Chunk *getChunk(int chunkX, int chunkZ);
+  // Takes world coordinates
+  void setLight(Chunk &chunk, LightChannel channel, int x, int y, int z,
+                uint8_t level);
+
+  // Spreads the queued nodes' light outwards
+  void propagate(LightChannel channel);
+  // Clears the light that came from the queued nodes, queueing the
+  // surrounding light that has to flow back in
+  void removeLight(LightChannel channel);
+
+public:
+  explicit LightEngine(World &world) : world(world) {}
+
+  // Lights a newly generated or loaded chunk, exchanging light with the
+  // loaded chunks around it.
+  void initChunk(Chunk &chunk);
+  // Removes the light that spread out of a chunk about to be unloaded from
+  // its neighbours. It flows back in if the chunk is loaded again.
+  void unloadChunk(const Chunk &chunk);
+
+  // Relights around a block that was just changed from old. Takes world
+  // coordinates.
+  void onBlockChanged(int x, int y, int z, const BlockState &old);
+
+  unsigned getChunksLit() const { return chunksLit; }
+  double getInitSeconds() const { return initSeconds; }
+  unsigned getRelights() const { return relights; }
+  double getRelightSeconds() const { return relightSeconds; }
+  double getLastRelightSeconds() const { return lastRelightSeconds; }
+};
+
+} // namespace MCPSP
@@ -0,0 +1,72 @@
+#pragma once
+#include "chunk_mesher.hpp"
+#include "chunk_position.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+
+#ifdef __PSP__
+#include <pspkerneltypes.h>
+#else
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#endif
+
+namespace MCPSP {
+
+struct MeshJob {
+  ChunkPosition position;
+  int sectionY;
+  uint32_t ticket;
+  SectionSnapshot snapshot;
+};
+
+struct MeshResult {
+  ChunkPosition position;
+  int sectionY;
+  uint32_t ticket;
+  MeshSet meshes;
+  SectionVisibility visibility;
+};
+
+// Runs ChunkMesher on a background thread. Jobs are processed in submission
+// order and finished meshes are queued until the main thread polls them.
+//
+// On the PSP the worker runs at a lower priority than the main thread, so it
+// only gets the CPU while the main thread waits, e.g. for vblank.
+class MeshWorker {
+  std::deque<MeshJob> jobs;
+  std::deque<MeshResult> results;
+  bool running = false;
+
+#ifdef __PSP__
+  SceUID thread = -1;
+  SceUID lock = -1;
+  SceUID jobSignal = -1;
+
+  static int entry(SceSize args, void *argp);
+#else
+  std::thread thread;
+  std::mutex mutex;
+  std::condition_variable jobSignal;
+#endif
+
+  void run();
+
+public:
+  MeshWorker() = default;
+  MeshWorker(const MeshWorker &) = delete;
+  MeshWorker &operator=(const MeshWorker &) = delete;
+  ~MeshWorker() { stop(); }
+
+  void start();
+  void stop();
+  bool isRunning() const { return running; }
+
+  void submit(MeshJob job);
+  // Takes the oldest finished mesh, if any.
+  bool poll(MeshResult &result);
+};
+
+} // namespace MCPSP
@@ -1,8 +1,11 @@
 #pragma once
 #include "resource_location.hpp"
+#include <cstddef>
+#include <memory>
 #include <raylib.h>
 #include <string>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 namespace MCPSP {
@@ -30,16 +33,40 @@ struct ModelElement {
 };
 
 class Model {
+  // Only the texture variables this model defines. The rest are looked up
+  // through the parent chain.
   std::unordered_map<std::string, std::string> textures;
-  std::vector<ModelElement> elements;
+  // Shared with the parent unless this model defines its own
+  std::shared_ptr<const std::vector<ModelElement>> elements;
+  std::shared_ptr<const Model> parent;
+
+  // Every model file read so far, so that common parents like block/cube are
+  // only read and parsed once
+  static std::unordered_map<ResourceLocation, std::shared_ptr<const Model>>
+      cache;
+  static std::size_t fileOpenCount;
+  static double parseSeconds;
 
   void loadModel(const MCPSP::ResourceLocation &location);
+  const std::string *findTexture(const std::string &name) const;
 
 public:
   Model() = default;
   Model(const MCPSP::ResourceLocation &location);
+  // A model whose face textures are already resolved locations rather than
+  // variables, as stored in asset bundles
+  explicit Model(std::vector<ModelElement> elements)
+      : elements(std::make_shared<const std::vector<ModelElement>>(
+            std::move(elements))) {}
+
+  // Loads the model, or returns the one loaded earlier
+  static std::shared_ptr<const Model> get(const ResourceLocation &location);
+
+  // Model files read from disk, and time spent reading and parsing them
+  static std::size_t getFileOpenCount() { return fileOpenCount; }
+  static double getParseSeconds() { return parseSeconds; }
 
-  const std::vector<ModelElement> &getElements() const { return elements; }
+  const std::vector<ModelElement> &getElements() const;
   ResourceLocation resolveTexture(const std::string &texture) const;
 };
 
@@ -0,0 +1,48 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace MCPSP {
+
+// Fixed-size array of 4-bit values packed two to a byte, the lower index in
+// the low nibble. An array holding the same value everywhere, such as the
+// light of a section deep underground or open to the sky, stores no bytes at
+// all until a different value is written.
+class NibbleArray {
+  std::vector<uint8_t> data;
+  std::size_t size;
+  uint8_t fill;
+
+public:
+  NibbleArray(std::size_t size, uint8_t fill) : size(size), fill(fill) {}
+
+  uint8_t get(std::size_t i) const {
+    if (data.empty()) {
+      return fill;
+    }
+    return data[i / 2] >> (i % 2 * 4) & 0xf;
+  }
+
+  void set(std::size_t i, uint8_t value) {
+    if (data.empty()) {
+      if (value == fill) {
+        return;
+      }
+      data.assign((size + 1) / 2, static_cast<uint8_t>(fill * 0x11));
+    }
+    int shift = i % 2 * 4;
+    uint8_t &byte = data[i / 2];
+    byte = static_cast<uint8_t>((byte & ~(0xf << shift)) | value << shift);
+  }
+
+  // Sets every value, releasing the packed storage.
+  void reset(uint8_t value) {
+    std::vector<uint8_t>().swap(data);
+    fill = value;
+  }
+
+  std::size_t getMemoryUsage() const { return data.capacity(); }
+};
+
+} // namespace MCPSP
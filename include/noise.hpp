@@ -0,0 +1,36 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+namespace MCPSP {
+
+// Which interpolation kernel the batched samplers use. Simd falls back to
+// Scalar on targets without a vector kernel; both give bit-identical results.
+enum class NoiseKernel { Scalar, Simd };
+
+// Seeded gradient (Perlin) noise in the range [-1, 1].
+//
+// Samples are taken in batches: corner gradients are gathered with table
+// lookups one point at a time, then the fade and interpolation math runs
+// over the whole batch, four points at a time on SSE2 or NEON. Every kernel
+// performs the same operations in the same order, so a seed produces the
+// same terrain on every platform.
+class GradientNoise {
+  uint8_t permutation[512];
+
+public:
+  explicit GradientNoise(uint64_t seed);
+
+  // out[i] = noise(x[i], z[i])
+  void sample2D(const float *x, const float *z, float *out, std::size_t count,
+                NoiseKernel kernel = NoiseKernel::Simd) const;
+  // out[i] = noise(x[i], y[i], z[i])
+  void sample3D(const float *x, const float *y, const float *z, float *out,
+                std::size_t count,
+                NoiseKernel kernel = NoiseKernel::Simd) const;
+
+  // Name of the kernel NoiseKernel::Simd resolves to on this target
+  static const char *getSimdKernelName();
+};
+
+} // namespace MCPSP
@@ -0,0 +1,98 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace MCPSP {
+
+// Fixed-size array of values stored as a palette of distinct values plus a
+// bit-packed array of palette indices. The number of bits per index grows with
+// the palette (0, 1, 2, 4, 8 or 16), so a container holding a single value
+// needs no index storage at all.
+//
+// Palette entries are never removed, so the initial value always stays at
+// palette index 0.
+template <typename T> class PalettedContainer {
+  std::vector<T> palette;
+  std::vector<uint32_t> data;
+  std::size_t size;
+  int bits = 0;
+
+  static std::size_t wordCount(std::size_t size, int bits) {
+    if (bits == 0) {
+      return 0;
+    }
+    std::size_t perWord = 32 / bits;
+    return (size + perWord - 1) / perWord;
+  }
+
+  void resize(int newBits) {
+    std::vector<uint32_t> newData(wordCount(size, newBits), 0);
+    int perWord = 32 / newBits;
+    for (std::size_t i = 0; i < size; ++i) {
+      newData[i / perWord] |= getIndex(i) << ((i % perWord) * newBits);
+    }
+    data = std::move(newData);
+    bits = newBits;
+  }
+
+  void setIndex(std::size_t i, uint32_t index) {
+    int perWord = 32 / bits;
+    int shift = (i % perWord) * bits;
+    uint32_t mask = ((1u << bits) - 1) << shift;
+    uint32_t &word = data[i / perWord];
+    word = (word & ~mask) | (index << shift);
+  }
+
+public:
+  PalettedContainer(std::size_t size, const T &initial) : size(size) {
+    palette.push_back(initial);
+  }
+
+  uint32_t getIndex(std::size_t i) const {
+    if (bits == 0) {
+      return 0;
+    }
+    int perWord = 32 / bits;
+    return (data[i / perWord] >> ((i % perWord) * bits)) & ((1u << bits) - 1);
+  }
+
+  const T &get(std::size_t i) const { return palette[getIndex(i)]; }
+
+  void set(std::size_t i, const T &value) {
+    uint32_t index = 0;
+    while (index < palette.size() && !(palette[index] == value)) {
+      ++index;
+    }
+    if (index == palette.size()) {
+      palette.push_back(value);
+      int needed = 0;
+      while ((1u << needed) < palette.size()) {
+        ++needed;
+      }
+      if (needed > bits) {
+        int newBits = bits == 0 ? 1 : bits;
+        while (newBits < needed) {
+          newBits *= 2;
+        }
+        resize(newBits);
+      }
+    }
+    if (bits != 0) {
+      setIndex(i, index);
+    }
+  }
+
+  const std::vector<T> &getPalette() const { return palette; }
+  int getBitsPerEntry() const { return bits; }
+  std::size_t getSize() const { return size; }
+
+  // Bytes used by the palette and the packed indices, excluding any heap
+  // memory owned by the palette entries themselves.
+  std::size_t getMemoryUsage() const {
+    return sizeof(*this) + palette.capacity() * sizeof(T) +
+           data.capacity() * sizeof(uint32_t);
+  }
+};
+
+} // namespace MCPSP
@@ -0,0 +1,106 @@
+#pragma once
+#include "chunk_position.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace MCPSP {
+
+class Chunk;
+
+// A file holding a REGION_SIZE x REGION_SIZE square of chunks.
+//
+// The file starts with a fixed header: a magic number and version, followed
+// by an offset and length for every chunk (0 if the chunk was never saved).
+// Since the header is read once when the file is opened, reading a chunk is a
+// single seek and read. On the host the file is memory mapped instead, and
+// chunks are decoded straight from the mapping.
+//
+// Chunks are rewritten in place when they still fit, and appended otherwise.
+// The space they leave behind is not reclaimed.
+class RegionFile {
+public:
+  static constexpr int REGION_SIZE = 16;
+  static constexpr int CHUNK_COUNT = REGION_SIZE * REGION_SIZE;
+  static constexpr uint32_t VERSION = 1;
+
+  // Bytes of a saved chunk. Only valid until the next read or write.
+  struct Record {
+    const uint8_t *data = nullptr;
+    std::size_t size = 0;
+  };
+
+private:
+  struct Entry {
+    uint32_t offset = 0;
+    uint32_t length = 0;
+  };
+
+  std::FILE *file = nullptr;
+  Entry entries[CHUNK_COUNT];
+
+#ifdef __PSP__
+  std::vector<uint8_t> buffer;
+#else
+  const uint8_t *mapping = nullptr;
+  std::size_t mappingSize = 0;
+
+  void unmap();
+  void map();
+#endif
+
+  RegionFile() = default;
+
+public:
+  RegionFile(const RegionFile &) = delete;
+  RegionFile &operator=(const RegionFile &) = delete;
+  ~RegionFile();
+
+  // Returns nullptr if the file doesn't exist and create is false. Throws if
+  // it exists but isn't a region file.
+  static std::unique_ptr<RegionFile> open(const std::string &path,
+                                          bool create);
+
+  // Coordinates are local to the region. Returns false if the chunk was
+  // never saved.
+  bool read(int x, int z, Record &record);
+  void write(int x, int z, const std::vector<uint8_t> &data);
+};
+
+// Saves and loads chunks through the region files in a directory, keeping
+// the ones it has touched open.
+class RegionStorage {
+  std::string directory;
+  std::unordered_map<ChunkPosition, std::unique_ptr<RegionFile>> regions;
+
+  std::vector<uint8_t> writeBuffer;
+
+  // Counters for the load benchmark
+  std::size_t chunksRead = 0;
+  std::size_t bytesRead = 0;
+  double readSeconds = 0.0;
+
+  RegionFile *getRegion(int chunkX, int chunkZ, bool create);
+
+public:
+  // An empty directory disables saving and loading
+  explicit RegionStorage(const std::string &directory = "")
+      : directory(directory) {}
+
+  bool isEnabled() const { return !directory.empty(); }
+
+  // Returns false if the chunk was never saved. Throws if it was saved but
+  // can't be read back.
+  bool loadChunk(Chunk &chunk);
+  void saveChunk(const Chunk &chunk);
+
+  std::size_t getChunksRead() const { return chunksRead; }
+  std::size_t getBytesRead() const { return bytesRead; }
+  double getReadSeconds() const { return readSeconds; }
+};
+
+} // namespace MCPSP
@@ -0,0 +1,33 @@
+#pragma once
+#include "raylib.h"
+#include <cstddef>
+#include <cstdint>
+
+namespace MCPSP {
+
+// How a face has to be blended, from its texture's alpha channel. Layers
+// are drawn in this order.
+enum class RenderLayer : uint8_t {
+  // Every texel is opaque; drawn without alpha test or blending
+  Solid,
+  // Texels are either opaque or fully transparent; drawn with alpha test
+  Cutout,
+  // Some texels are partly transparent; blended, back to front
+  Translucent,
+};
+
+constexpr int RENDER_LAYER_COUNT = 3;
+
+inline RenderLayer classifyPixels(const Color *pixels, std::size_t count) {
+  RenderLayer layer = RenderLayer::Solid;
+  for (std::size_t i = 0; i < count; ++i) {
+    if (pixels[i].a == 0) {
+      layer = RenderLayer::Cutout;
+    } else if (pixels[i].a != 255) {
+      return RenderLayer::Translucent;
+    }
+  }
+  return layer;
+}
+
+} // namespace MCPSP
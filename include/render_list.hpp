@@ -0,0 +1,119 @@
+#pragma once
+#include "chunk_section.hpp"
+#include "chunk_vertex.hpp"
+#include "raylib.h"
+#include "texture_manager.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace MCPSP {
+
+// Fixed-function state a draw item needs, as bit flags. Items are drawn in
+// increasing order of state, so solid geometry (no flags) comes first and
+// blended geometry last.
+enum RenderStateFlags : uint8_t {
+  RENDER_ALPHA_TEST = 1 << 0,
+  // Alpha blending without depth writes, drawn back to front
+  RENDER_BLEND = 1 << 1,
+};
+
+// One mesh of one section, queued for drawing this frame.
+struct DrawItem {
+  // State, texture and depth packed in the order RenderList::sort wants
+  uint64_t key;
+  // Bits of the squared camera distance, which order like the float does as
+  // it is never negative
+  uint32_t depth;
+  uint8_t state;
+  TextureHandle texture;
+  const Mesh *mesh;
+  // Section origin, in blocks
+  Vector3 origin;
+};
+
+// Receives the state changes and draws of a submitted RenderList. Only
+// called when something actually changes.
+class RenderBackend {
+public:
+  virtual ~RenderBackend() = default;
+
+  virtual void begin() = 0;
+  virtual void setState(uint8_t state) = 0;
+  virtual void bindTexture(TextureHandle texture) = 0;
+  virtual void setOrigin(const Vector3 &origin) = 0;
+  virtual void drawMesh(const Mesh &mesh) = 0;
+  virtual void end() = 0;
+};
+
+// Draws through pspgl and rlgl.
+class GLRenderBackend : public RenderBackend {
+public:
+  void begin() override;
+  void setState(uint8_t state) override;
+  void bindTexture(TextureHandle texture) override;
+  void setOrigin(const Vector3 &origin) override;
+  void drawMesh(const Mesh &mesh) override;
+  void end() override;
+};
+
+// Counts calls instead of drawing, so submission can be checked without a
+// GPU.
+class MockRenderBackend : public RenderBackend {
+public:
+  unsigned stateChanges = 0;
+  unsigned textureBinds = 0;
+  unsigned originChanges = 0;
+  unsigned drawCalls = 0;
+  std::size_t quadsDrawn = 0;
+
+  void begin() override {}
+  void setState(uint8_t) override { ++stateChanges; }
+  void bindTexture(TextureHandle) override { ++textureBinds; }
+  void setOrigin(const Vector3 &) override { ++originChanges; }
+  void drawMesh(const Mesh &mesh) override {
+    ++drawCalls;
+    quadsDrawn += mesh.vertices.size() / 4;
+  }
+  void end() override {}
+};
+
+enum class DrawOrder : uint8_t {
+  // Fewest texture binds: items sharing state and texture are drawn
+  // together, nearest first
+  ByTexture,
+  // Nearest first within each state, so the depth test rejects more hidden
+  // pixels, at the cost of more texture binds
+  FrontToBack,
+};
+// Either way, blended items are drawn farthest first so they composite
+// correctly.
+
+// The draws of a frame, collected across all chunks and then submitted in
+// one pass ordered by state and texture rather than by chunk.
+class RenderList {
+  std::vector<DrawItem> items;
+
+public:
+  struct SubmitStats {
+    unsigned stateChanges = 0;
+    unsigned textureBinds = 0;
+    unsigned drawCalls = 0;
+  };
+
+  void clear() { items.clear(); }
+  std::size_t size() const { return items.size(); }
+
+  // distance is the squared distance from the camera, for ordering within a
+  // state.
+  void add(uint8_t state, TextureHandle texture, const Mesh &mesh,
+           const Vector3 &origin, float distance);
+
+  void sort(DrawOrder order);
+
+  // Replays the items into backend, changing state and texture only where
+  // they differ from the previous item.
+  SubmitStats submit(RenderBackend &backend) const;
+};
+
+} // namespace MCPSP
@@ -1,42 +1,66 @@
 #pragma once
-#include <filesystem>
-#include <string>
+#include <cstddef>
+#include <cstdint>
 #include <functional>
+#include <string>
 
 namespace MCPSP {
 
+// A namespaced ID such as "minecraft:dirt". Locations are interned: each
+// distinct ID is stored once in a global table and a ResourceLocation is just a
+// dense 16-bit handle into it, so copies, comparisons and hashing never touch
+// strings.
+//
+// Interning is not thread-safe; create locations on the main thread only.
+// Copying, comparing and hashing existing locations is safe from any thread,
+// as none of them read the table.
 class ResourceLocation {
+  uint16_t id;
+
+  struct Entry {
     std::string ns;
     std::string path;
-  
-  public:
-    const std::string &getNamespace() const { return ns; }
-    const std::string &getPath() const { return path; }
+  };
+  struct Table;
+
+  static std::string assetRoot;
+
+  static Table &getTable();
+  static const Entry &getEntry(uint16_t id);
+  static uint16_t intern(const std::string &ns, const std::string &path);
+
+  explicit ResourceLocation(uint16_t id) : id(id) {}
 
 public:
-  ResourceLocation(const std::string &nid) {
-    int colon = nid.find(':');
-    if (colon == std::string::npos) {
-      ns = "minecraft";
-      path = nid;
-    } else {
-      ns = nid.substr(0, colon);
-      path = nid.substr(colon + 1);
-    }
-  }
+  // Handle of "minecraft:air", which is always the first interned location.
+  static constexpr uint16_t AIR_ID = 0;
+
+  ResourceLocation(const std::string &nid);
+
+  static ResourceLocation fromId(uint16_t id) { return ResourceLocation(id); }
+  static std::size_t getInternedCount();
+
+  uint16_t getId() const { return id; }
+  const std::string &getNamespace() const { return getEntry(id).ns; }
+  const std::string &getPath() const { return getEntry(id).path; }
+
+  // Directory holding the namespace folders. Defaults to "umd0:/assets";
+  // host tools point it at an extracted assets tree instead.
+  static void setAssetRoot(const std::string &root) { assetRoot = root; }
+  static const std::string &getAssetRoot() { return assetRoot; }
 
-  std::string resolvePath(const std::string ctx) const {
-    return "umd0:/assets/" + ns + "/" + ctx + "/" + path;
+  std::string resolvePath(const std::string &ctx) const {
+    return assetRoot + "/" + getNamespace() + "/" + ctx + "/" + getPath();
   }
 
-  operator std::string() const { return ns + ":" + path; }
+  operator std::string() const { return getNamespace() + ":" + getPath(); }
 
   bool operator==(const ResourceLocation &other) const {
-    return ns == other.ns && path == other.path;
+    return id == other.id;
   }
 
   bool operator!=(const ResourceLocation &other) const {
-    return ns != other.ns || path != other.path;
+    return id != other.id;
   }
 };
 
@@ -44,9 +68,9 @@ public:
 
 namespace std {
 template <> struct hash<MCPSP::ResourceLocation> {
+  // Handles are dense and unique, which makes them a perfect hash
   std::size_t operator()(const MCPSP::ResourceLocation &loc) const noexcept {
-    return std::hash<std::string>()(loc.getNamespace()) ^
-           (std::hash<std::string>()(loc.getPath()) << 1);
+    return loc.getId();
   }
 };
 } // namespace std
@@ -0,0 +1,35 @@
+#pragma once
+#include "direction.hpp"
+#include <cstdint>
+
+namespace MCPSP {
+
+// Which faces of a section can be seen from which others, by looking through
+// the non-opaque blocks inside it. Used to skip sections hidden behind solid
+// ground, e.g. caves that don't open up towards the camera.
+class SectionVisibility {
+  // Bit (a * 6 + b) is set if face b can be seen from face a
+  uint64_t connections;
+
+  explicit SectionVisibility(uint64_t connections)
+      : connections(connections) {}
+
+public:
+  // Sections start out fully connected until they are meshed, so they are
+  // never hidden by mistake
+  SectionVisibility() : connections((uint64_t(1) << 36) - 1) {}
+
+  static SectionVisibility none() { return SectionVisibility(0); }
+  static SectionVisibility all() { return SectionVisibility(); }
+
+  void connect(Direction a, Direction b) {
+    connections |= uint64_t(1) << (static_cast<int>(a) * 6 + static_cast<int>(b));
+    connections |= uint64_t(1) << (static_cast<int>(b) * 6 + static_cast<int>(a));
+  }
+
+  bool isConnected(Direction a, Direction b) const {
+    return connections >> (static_cast<int>(a) * 6 + static_cast<int>(b)) & 1;
+  }
+};
+
+} // namespace MCPSP
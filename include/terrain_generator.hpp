@@ -0,0 +1,46 @@
+#pragma once
+#include "chunk_section.hpp"
+#include "noise.hpp"
+#include <cstddef>
+#include <cstdint>
+
+namespace MCPSP {
+
+class Chunk;
+
+// Fills chunks with hilly terrain from a seed. A fractal 2D heightmap sets
+// the surface, and optional 3D density noise carves overhangs and caves
+// into it.
+class TerrainGenerator {
+  uint64_t seed;
+  GradientNoise heightNoise;
+  GradientNoise densityNoise;
+  bool densityEnabled = false;
+
+  // Totals for the chunks per second benchmark
+  std::size_t chunksGenerated = 0;
+  double generateSeconds = 0.0;
+
+  void generateHeightmap(int chunkX, int chunkZ, float heights[256]) const;
+
+public:
+  static constexpr int SEA_LEVEL = 24;
+  static constexpr int OCTAVES = 4;
+
+  explicit TerrainGenerator(uint64_t seed)
+      : seed(seed), heightNoise(seed), densityNoise(seed ^ 0x5deece66dull) {}
+
+  uint64_t getSeed() const { return seed; }
+
+  // Costs a 3D noise sample per block near the surface, so it is off by
+  // default
+  void setDensityEnabled(bool enabled) { densityEnabled = enabled; }
+
+  // Writes the terrain into a freshly constructed, all-air chunk
+  void generate(Chunk &chunk);
+
+  std::size_t getChunksGenerated() const { return chunksGenerated; }
+  double getGenerateSeconds() const { return generateSeconds; }
+};
+
+} // namespace MCPSP
@@ -0,0 +1,58 @@
+#pragma once
+#include "raylib.h"
+#include "resource_location.hpp"
+#include <unordered_map>
+#include <vector>
+
+namespace MCPSP {
+
+// Where a texture ended up in the atlas. UVs are normalized to the page.
+struct AtlasRegion {
+  ResourceLocation page = ResourceLocation::fromId(ResourceLocation::AIR_ID);
+  Vector2 uvMin = {0.0f, 0.0f};
+  Vector2 uvMax = {1.0f, 1.0f};
+
+  // Maps a UV inside the source texture to page space
+  Vector2 map(Vector2 uv) const {
+    return {uvMin.x + uv.x * (uvMax.x - uvMin.x),
+            uvMin.y + uv.y * (uvMax.y - uvMin.y)};
+  }
+};
+
+// Packs many small textures into a few square, power-of-two pages so that
+// geometry using different textures can be drawn with a single bind.
+//
+// Each tile is surrounded by PADDING pixels copied from its own edges, so
+// sampling slightly outside a tile never picks up a neighbouring one. Pages
+// are mipmapped tile by tile, and the padding also keeps tiles aligned so
+// that the first two levels still start on whole texels.
+class TextureAtlas {
+  std::vector<ResourceLocation> textures;
+  std::unordered_map<ResourceLocation, AtlasRegion> regions;
+  std::vector<ResourceLocation> pages;
+  ResourceLocation name;
+
+public:
+  // 256x256 RGBA pages are 256 KiB each, or 65 KiB once palettized, which
+  // leaves room in the PSP's 2 MiB of VRAM for the frame and depth buffers.
+  static constexpr int PAGE_SIZE = 256;
+  static constexpr int PADDING = 4;
+
+  explicit TextureAtlas(const ResourceLocation &name) : name(name) {}
+
+  void addTexture(const ResourceLocation &texture);
+
+  // Loads all added textures, packs them into pages and registers each page
+  // with the TextureManager as "<name>_<index>".
+  void stitch();
+
+  // Returns nullptr for textures that were never added or failed to load.
+  const AtlasRegion *getRegion(const ResourceLocation &texture) const {
+    auto it = regions.find(texture);
+    return it != regions.end() ? &it->second : nullptr;
+  }
+
+  const std::vector<ResourceLocation> &getPages() const { return pages; }
+};
+
+} // namespace MCPSP
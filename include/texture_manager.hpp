@@ -1,23 +1,161 @@
 #pragma once
 
 #include "raylib.h"
+#include "render_layer.hpp"
 #include "resource_location.hpp"
+#include "texture_quantizer.hpp"
+#include "texture_transforms.hpp"
+#include <cstddef>
+#include <cstdint>
 #include <string>
 #include <unordered_map>
+#include <vector>
 namespace MCPSP {
 
+// Index of a texture slot. Handles are resolved once when models are baked,
+// so binding a texture while drawing is an array lookup rather than a path
+// lookup.
+using TextureHandle = uint16_t;
+
+// Owns every texture and keeps the loaded ones within a memory budget.
+// Textures are loaded on first use. Once over budget, the least recently used
+// textures not drawn this frame are unloaded, starting with those no mesh
+// references, and loaded again the next time they are needed.
+//
+// When palettizing is on, textures are quantized to CLUT4 or CLUT8 before
+// upload, which takes a quarter to an eighth of the VRAM of RGBA. Textures
+// with more colours than a CLUT holds stay RGBA instead. Uploads also get a
+// box-filtered mip chain, so distant terrain samples small levels that stay
+// in the GE's texture cache instead of aliasing.
+//
+// Not thread-safe; only use it from the main thread.
 class TextureManager {
-  static std::unordered_map<std::string, Texture2D> textureCache;
+public:
+  struct Stats {
+    // Lookups that found the texture loaded, and ones that had to load it
+    unsigned hits = 0;
+    unsigned misses = 0;
+    unsigned evictions = 0;
+    // Textures uploaded with a palette, and ones left as RGBA because they
+    // had too many colours to convert losslessly
+    unsigned indexed = 0;
+    unsigned reduced = 0;
+    // Textures run through the upload stage, and the time spent building
+    // mip levels and palettes for them
+    unsigned converted = 0;
+    double convertSeconds = 0.0;
+  };
+
+  // Enough for the atlas pages and a working set of source textures while
+  // leaving VRAM for the frame buffers
+  static constexpr std::size_t DEFAULT_BUDGET = 1024 * 1024;
+  // The GE samples up to eight levels, the base included
+  static constexpr int MAX_MIP_LEVELS = 7;
+
+private:
+  struct Slot {
+    ResourceLocation location;
+    Texture2D texture = {};
+    bool loaded = false;
+    // Built at runtime, such as atlas pages, so it can't be reloaded from
+    // disk and is never evicted
+    bool pinned = false;
+    // Meshes currently drawn with this texture
+    int refCount = 0;
+    uint32_t lastUsed = 0;
+    std::size_t bytes = 0;
+    // What the texture would take as RGBA, for comparison
+    std::size_t rgbaBytes = 0;
+    // Kept across evictions, as it never changes
+    bool classified = false;
+    RenderLayer layer = RenderLayer::Solid;
+  };
+
+  static std::vector<Slot> slots;
+  static std::unordered_map<ResourceLocation, TextureHandle> handles;
+  static std::size_t budget;
+  static std::size_t residentBytes;
+  static std::size_t residentRgbaBytes;
+  static bool palettized;
+  static bool mipmapped;
+  static uint32_t frame;
+  static Stats stats;
+
+  static std::string getPath(const ResourceLocation &location) {
+    return location.resolvePath("textures") + ".png";
+  }
+
+  static void load(Slot &slot);
+  // Uploads an RGBA8 image, with mip levels that keep to the given tiles,
+  // palettized if enabled
+  static void upload(Slot &slot, const Image &image,
+                     const std::vector<MipTile> &tiles);
+  static void unload(Slot &slot);
+  // Evicts textures until the budget is met or only ones drawn this frame
+  // are left.
+  static void evictToBudget();
 
 public:
-  static const Texture2D &getTexture(const ResourceLocation &location) {
-    std::string path = location.resolvePath("textures") + ".png";
-    if (textureCache.find(path) == textureCache.end()) {
-      Texture2D texture = LoadTexture(path.c_str());
-      textureCache[path] = texture;
+  // Returns the handle for location, creating a slot if there isn't one yet.
+  // Doesn't load the texture.
+  static TextureHandle getHandle(const ResourceLocation &location);
+
+  // Layer faces with this texture are drawn in, from its alpha channel.
+  // Worked out once per texture, reading the image if it isn't loaded yet.
+  static RenderLayer getLayer(TextureHandle handle);
+
+  static const Texture2D &get(TextureHandle handle) {
+    Slot &slot = slots[handle];
+    slot.lastUsed = frame;
+    if (slot.loaded) {
+      ++stats.hits;
+    } else {
+      ++stats.misses;
+      load(slot);
+      evictToBudget();
     }
-    return textureCache[path];
+    return slot.texture;
   }
+
+  static const Texture2D &getTexture(const ResourceLocation &location) {
+    return get(getHandle(location));
+  }
+
+  // Makes a texture that was built at runtime, such as an atlas page,
+  // available through getTexture. It stays loaded until shutdown.
+  static TextureHandle registerTexture(const ResourceLocation &location,
+                                       const Texture2D &texture);
+  // Same, but uploads the image itself so it can be palettized and
+  // mipmapped. The image must be RGBA8 and is left to the caller to unload.
+  // Mip levels of an atlas page keep to its tiles, see buildMipChain.
+  static TextureHandle registerImage(const ResourceLocation &location,
+                                     const Image &image,
+                                     const std::vector<MipTile> &tiles = {});
+
+  // Counts meshes drawn with a texture. Unreferenced textures are evicted
+  // first.
+  static void acquire(TextureHandle handle) { ++slots[handle].refCount; }
+  static void release(TextureHandle handle) { --slots[handle].refCount; }
+
+  // Textures used since the last call count as in use for eviction
+  static void beginFrame() { ++frame; }
+
+  // Bytes of texture data to keep loaded. Lowering it evicts straight away.
+  static void setBudget(std::size_t bytes);
+  static std::size_t getBudget() { return budget; }
+  static std::size_t getResidentBytes() { return residentBytes; }
+  // What the loaded textures would take uncompressed
+  static std::size_t getResidentRgbaBytes() { return residentRgbaBytes; }
+  static std::size_t getCount() { return slots.size(); }
+
+  // Applies to textures loaded from then on
+  static void setPalettized(bool enabled) { palettized = enabled; }
+  static bool isPalettized() { return palettized; }
+  static void setMipmapped(bool enabled) { mipmapped = enabled; }
+  static bool isMipmapped() { return mipmapped; }
+
+  static const Stats &getStats() { return stats; }
+  static void resetStats() { stats = Stats(); }
 };
 
 } // namespace MCPSP
@@ -0,0 +1,57 @@
+#pragma once
+#include "raylib.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace MCPSP {
+
+// Indexed texture formats the GE samples through a colour lookup table
+enum class ClutFormat : uint8_t { Clut4, Clut8 };
+
+// An RGBA image reduced to palette indices. Nothing here touches the GPU, so
+// conversion can run and be checked on the host.
+struct IndexedImage {
+  int width = 0;
+  int height = 0;
+  ClutFormat format = ClutFormat::Clut8;
+  // 16 entries for Clut4 and 256 for Clut8, padded with transparent black
+  std::vector<Color> palette;
+  // One byte per pixel for Clut8. Clut4 packs two pixels per byte, the
+  // left one in the low nibble, which is the order the GE reads them in.
+  std::vector<uint8_t> indices;
+  // False if the image had more colours than the palette and was reduced
+  bool exact = true;
+
+  uint8_t getIndex(int x, int y) const {
+    std::size_t i = static_cast<std::size_t>(y) * width + x;
+    if (format == ClutFormat::Clut8) {
+      return indices[i];
+    }
+    return (indices[i / 2] >> (i % 2 * 4)) & 0xf;
+  }
+
+  Color getPixel(int x, int y) const { return palette[getIndex(x, y)]; }
+
+  // Bytes of VRAM for the indices and the lookup table
+  std::size_t getBytes() const {
+    return indices.size() + palette.size() * sizeof(Color);
+  }
+};
+
+// Picks up to maxColors colours for the given pixels. Every distinct colour
+// is kept when they fit; otherwise they are reduced by median cut. Fully
+// transparent pixels all count as one colour. Passing the pixels of several
+// textures builds a palette they can share.
+std::vector<Color> buildPalette(const Color *pixels, std::size_t count,
+                                int maxColors);
+
+// Maps every pixel to the closest palette colour. Palettes of up to 16
+// colours produce Clut4 images, larger ones Clut8.
+IndexedImage applyPalette(const Color *pixels, int width, int height,
+                          const std::vector<Color> &palette);
+
+// Converts one texture with a palette of its own.
+IndexedImage quantizeImage(const Color *pixels, int width, int height);
+
+} // namespace MCPSP
@@ -0,0 +1,38 @@
+#pragma once
+#include "raylib.h"
+#include <vector>
+
+namespace MCPSP {
+
+// A region of an image that is filtered on its own, such as an atlas tile.
+// x, y, width and height give the tile itself; padding is the border around
+// it that holds copies of its edge pixels.
+struct MipTile {
+  int x;
+  int y;
+  int width;
+  int height;
+  int padding;
+};
+
+struct MipLevel {
+  int width;
+  int height;
+  std::vector<Color> pixels;
+};
+
+// Number of levels below the base that keep every tile on whole texels:
+// the image and each tile must halve evenly, and tiles with padding keep at
+// least a texel of it. Capped at maxLevels.
+int getMipLevelCount(int width, int height, const std::vector<MipTile> &tiles,
+                     int maxLevels);
+
+// Builds levels 1 to levelCount of an RGBA image (level 0 is the image
+// itself) with a 2x2 box filter. Colours are weighted by alpha so transparent
+// texels don't darken the edges of cutouts. Tile interiors only ever average
+// their own texels, and their padding is extended again at every level.
+std::vector<MipLevel> buildMipChain(const Color *pixels, int width, int height,
+                                    int levelCount,
+                                    const std::vector<MipTile> &tiles = {});
+
+} // namespace MCPSP
@@ -0,0 +1,120 @@
+#pragma once
+#include "chunk_position.hpp"
+#include "resource_location.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace MCPSP {
+
+// A block update requested for a later game tick. It only runs if the block
+// at the position is still the one it was scheduled for.
+struct ScheduledTick {
+  ChunkPosition chunk;
+  // Position within the chunk, x + z * 16 + y * 256
+  uint16_t index;
+  ResourceLocation block = ResourceLocation::fromId(ResourceLocation::AIR_ID);
+
+  static uint16_t packIndex(int x, int y, int z) {
+    return static_cast<uint16_t>(x | z << 4 | y << 8);
+  }
+  int getX() const { return index & 15; }
+  int getY() const { return index >> 8; }
+  int getZ() const { return index >> 4 & 15; }
+};
+
+// Identifies a scheduled tick for cancelling. Stays safe to use after the
+// tick has run or been cancelled, when cancelling does nothing.
+struct TickHandle {
+  uint32_t index = UINT32_MAX;
+  uint32_t generation = 0;
+};
+
+// Keeps scheduled ticks in a hierarchical timing wheel, so that scheduling,
+// cancelling and advancing a tick take constant time however many ticks are
+// waiting.
+//
+// Each of the wheel's levels has 64 slots. Level 0 slots hold the ticks due
+// within the next 64 game ticks, one slot per tick; each higher level's slots
+// cover 64 times as many ticks. When the lower levels wrap around, the next
+// slot of the level above is spread back down into them. Ticks further ahead
+// than the top level wait in an overflow list.
+//
+// Due ticks move to a ready list, which is drained a budget at a time, so a
+// burst of ticks spreads over later game ticks instead of stalling one.
+class TickScheduler {
+  static constexpr int SLOT_BITS = 6;
+  static constexpr int SLOT_COUNT = 1 << SLOT_BITS;
+  static constexpr int LEVEL_COUNT = 4;
+  static constexpr uint32_t OVERFLOW_LIST = LEVEL_COUNT * SLOT_COUNT;
+  static constexpr uint32_t READY_LIST = OVERFLOW_LIST + 1;
+  static constexpr uint32_t LIST_COUNT = READY_LIST + 1;
+  static constexpr uint32_t NONE = UINT32_MAX;
+
+  // Entries are linked into one list (a wheel slot, overflow or ready) and
+  // into the list of their chunk, by index so the pool can grow
+  struct Entry {
+    ScheduledTick tick;
+    uint64_t due;
+    uint32_t generation = 0;
+    uint32_t list = NONE;
+    uint32_t prev = NONE, next = NONE;
+    uint32_t chunkPrev = NONE, chunkNext = NONE;
+  };
+  struct List {
+    uint32_t head = NONE, tail = NONE;
+  };
+
+  std::vector<Entry> entries;
+  uint32_t freeHead = NONE;
+  std::vector<List> lists = std::vector<List>(LIST_COUNT);
+  std::unordered_map<ChunkPosition, uint32_t> chunkHeads;
+  uint64_t currentTick = 0;
+  std::size_t scheduledCount = 0;
+  std::size_t readyCount = 0;
+
+  void link(uint32_t index, uint32_t list);
+  void unlink(uint32_t index);
+  void release(uint32_t index);
+  // Links an entry into the wheel slot, overflow or ready list for its due
+  // tick
+  void place(uint32_t index);
+  void cascade(uint32_t list);
+
+public:
+  // A tick of a saved chunk, due delay game ticks after the current one
+  struct SavedTick {
+    uint16_t index;
+    ResourceLocation block =
+        ResourceLocation::fromId(ResourceLocation::AIR_ID);
+    uint32_t delay;
+  };
+
+  uint64_t getCurrentTick() const { return currentTick; }
+
+  // Schedules tick to run delay game ticks from now. A delay of 0 makes it
+  // ready straight away.
+  TickHandle schedule(const ScheduledTick &tick, uint32_t delay);
+  // Returns false if the tick already ran or was cancelled
+  bool cancel(TickHandle handle);
+
+  // Moves on to the next game tick, readying the ticks due in it.
+  void advance();
+
+  // Takes up to budget ready ticks, oldest first, grouped by chunk so that
+  // each chunk only needs looking up once. The rest stay ready for later.
+  void takeReady(std::vector<ScheduledTick> &out, int budget);
+
+  // Ticks of one chunk, for saving it
+  void getChunkTicks(const ChunkPosition &chunk,
+                     std::vector<SavedTick> &out) const;
+  // Cancels every tick of a chunk, for unloading it
+  void removeChunk(const ChunkPosition &chunk);
+
+  // Ticks waiting in the wheel or ready to run
+  std::size_t getScheduledCount() const { return scheduledCount; }
+  std::size_t getReadyCount() const { return readyCount; }
+};
+
+} // namespace MCPSP
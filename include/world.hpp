@@ -1,44 +1,163 @@
 #pragma once
 #include "chunk.hpp"
+#include "chunk_position.hpp"
+#include "frustum.hpp"
+#include "light_engine.hpp"
+#include "mesh_worker.hpp"
+#include "region_file.hpp"
+#include "render_list.hpp"
+#include "terrain_generator.hpp"
+#include "tick_scheduler.hpp"
 #include <unordered_map>
 
 namespace MCPSP {
 
-struct ChunkPosition {
-  int x, z;
-
-  bool operator==(const ChunkPosition &other) const {
-    return x == other.x && z == other.z;
-  }
-};
-
-} // namespace MCPSP
-
-namespace std {
-template <> struct hash<MCPSP::ChunkPosition> {
-  std::size_t operator()(const MCPSP::ChunkPosition &pos) const noexcept {
-    return std::hash<int>()(pos.x) ^ (std::hash<int>()(pos.z) << 1);
-  }
+struct RaycastHit {
+  bool hit = false;
+  // The block hit, in world coordinates
+  int x = 0, y = 0, z = 0;
+  BlockState block;
+  // Side of the block the ray entered through. None if the ray started
+  // inside it.
+  Direction face = Direction::None;
+  // Where the ray hit, and how far along it that was
+  Vector3 position = {0, 0, 0};
+  float distance = 0.0f;
 };
-} // namespace std
-
-namespace MCPSP {
 
 class World {
 private:
   std::unordered_map<ChunkPosition, Chunk> chunks;
 
+  RegionStorage storage;
+  TerrainGenerator generator;
+  LightEngine lightEngine{*this};
+
+  TickScheduler ticks;
+  int tickBudget = 64;
+  unsigned ticksRun = 0;
+  // Reused between ticks to avoid reallocating
+  std::vector<ScheduledTick> dueTicks;
+
+  void markNeighborsDirty(int x, int z);
+
+  MeshWorker meshWorker;
+  uint32_t nextMeshTicket = 0;
+  int meshUploadBudget = 4;
+  int meshQueueBudget = 8;
+
+  DrawStats drawStats;
+  // Rebuilt every frame; kept to reuse its storage
+  RenderList renderList;
+  DrawOrder drawOrder = DrawOrder::ByTexture;
+  // Sections found by the occlusion search, as a bit mask per chunk.
+  // Reused between frames to avoid reallocating.
+  std::unordered_map<ChunkPosition, uint32_t> reachableSections;
+
+  // Walks outwards from the camera's section through the faces each section
+  // can see through. Returns false if the camera isn't somewhere the walk
+  // can start from, in which case nothing is occluded.
+  bool findReachableSections(const Camera3D &camera, const Frustum &frustum);
+
 public:
-  World() = default;
+  explicit World(uint64_t seed = 0) : generator(seed) {}
+
+  TerrainGenerator &getGenerator() { return generator; }
+  LightEngine &getLightEngine() { return lightEngine; }
+  TickScheduler &getTickScheduler() { return ticks; }
+
+  // Where chunks are saved to and loaded from. Saving is off until set.
+  void setSaveDirectory(const std::string &directory) {
+    storage = RegionStorage(directory);
+  }
+  const RegionStorage &getStorage() const { return storage; }
 
   void generateChunk(int x, int z);
+  // Loads a previously saved chunk. Returns false if there is none, or if it
+  // couldn't be read.
+  bool loadChunk(int x, int z);
+
+  // Saves the chunk if it was edited, then removes it, keeping its
+  // neighbours' borders up to date.
+  void unloadChunk(int x, int z);
+  // Saves every edited chunk
+  void save();
+
+  // Call at the start of each frame. Swaps in up to the upload budget of
+  // finished meshes and hands up to the queue budget of dirty sections to
+  // the mesh worker, nearest to focus first.
+  void update(const Vector3 &focus);
+
+  // Runs one game tick: the scheduled ticks that are due, up to the tick
+  // budget. Ticks over budget run in later game ticks.
+  void tick();
+
+  // Schedules a tick of the block now at (x, y, z), in world coordinates,
+  // delay game ticks from now. The tick is saved with the chunk, which is
+  // marked modified. Returns an invalid handle if the chunk isn't loaded.
+  TickHandle scheduleTick(int x, int y, int z, uint32_t delay);
+  bool cancelTick(TickHandle handle) { return ticks.cancel(handle); }
+
+  void setTickBudget(int budget) { tickBudget = budget; }
+  // Scheduled ticks run by the last tick()
+  unsigned getTicksRun() const { return ticksRun; }
+
+  void setMeshUploadBudget(int budget) { meshUploadBudget = budget; }
+  void setMeshQueueBudget(int budget) { meshQueueBudget = budget; }
 
-  void draw() {
+  // Draws the chunks visible from the camera, which must be the one passed
+  // to the enclosing BeginMode3D.
+  void draw(const Camera3D &camera);
+
+  // Finds the first non-air block along a ray, within maxDistance of origin.
+  // Blocks are hit where their model's elements are, so rays pass through
+  // the open parts of blocks like torches. Unloaded chunks are empty.
+  RaycastHit raycast(const Vector3 &origin, const Vector3 &direction,
+                     float maxDistance) const;
+
+  // Counters from the last draw()
+  const DrawStats &getDrawStats() const { return drawStats; }
+
+  void setDrawOrder(DrawOrder order) { drawOrder = order; }
+  DrawOrder getDrawOrder() const { return drawOrder; }
+
+  // Switches meshing mode and remeshes every loaded chunk with it
+  void setMeshingMode(MeshingMode mode) {
+    Chunk::setMeshingMode(mode);
     for (auto &[pos, chunk] : chunks) {
-      Vector3 position = {static_cast<float>(pos.x * 16), 0.0f,
-                          static_cast<float>(pos.z * 16)};
-      chunk.draw(position);
+      chunk.markDirty();
+    }
+  }
+
+  std::size_t getVertexCount() const {
+    std::size_t count = 0;
+    for (const auto &[pos, chunk] : chunks) {
+      count += chunk.getVertexCount();
+    }
+    return count;
+  }
+
+  std::size_t getVertexBytes() const {
+    std::size_t bytes = 0;
+    for (const auto &[pos, chunk] : chunks) {
+      bytes += chunk.getVertexBytes();
+    }
+    return bytes;
+  }
+
+  // Block storage and meshes of every loaded chunk
+  std::size_t getMemoryUsage() const {
+    std::size_t bytes = 0;
+    for (const auto &[pos, chunk] : chunks) {
+      bytes += sizeof(Chunk) + chunk.getMemoryUsage() + chunk.getVertexBytes();
     }
+    return bytes;
+  }
+
+  std::size_t getChunkCount() const { return chunks.size(); }
+
+  const std::unordered_map<ChunkPosition, Chunk> &getChunks() const {
+    return chunks;
   }
 
   bool hasChunk(int x, int z) const {
@@ -54,6 +173,15 @@ public:
     }
     return nullptr;
   }
+
+  Chunk *getChunk(int x, int z) {
+    ChunkPosition pos{x, z};
+    auto it = chunks.find(pos);
+    if (it != chunks.end()) {
+      return &it->second;
+    }
+    return nullptr;
+  }
 };
 
 } // namespace MCPSP
@@ -0,0 +1,185 @@
+#include "asset_bundle.hpp"
+#include "byte_buffer.hpp"
+#include "direction.hpp"
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace MCPSP {
+
+static const char BUNDLE_MAGIC[4] = {'M', 'C', 'P', 'B'};
+
+// Strings are written once and referred to by index
+class StringTable {
+  std::unordered_map<std::string, uint16_t> indices;
+
+public:
+  std::vector<std::string> strings;
+
+  uint16_t add(const std::string &value) {
+    auto it = indices.find(value);
+    if (it != indices.end()) {
+      return it->second;
+    }
+    if (strings.size() > UINT16_MAX) {
+      throw std::runtime_error("too many strings in asset bundle");
+    }
+    uint16_t index = static_cast<uint16_t>(strings.size());
+    strings.push_back(value);
+    indices.emplace(value, index);
+    return index;
+  }
+};
+
+static void writeVector(ByteWriter &out, Vector3 value) {
+  out.f32(value.x);
+  out.f32(value.y);
+  out.f32(value.z);
+}
+
+static Vector3 readVector(ByteReader &in) {
+  Vector3 value;
+  value.x = in.f32();
+  value.y = in.f32();
+  value.z = in.f32();
+  return value;
+}
+
+Model AssetBundle::flatten(const Model &model) {
+  std::vector<ModelElement> elements = model.getElements();
+  for (ModelElement &element : elements) {
+    for (auto &[direction, face] : element.faces) {
+      face.texture = model.resolveTexture(face.texture);
+    }
+  }
+  return Model(std::move(elements));
+}
+
+void AssetBundle::write(const std::string &path) const {
+  StringTable strings;
+  std::vector<uint8_t> body;
+  ByteWriter out(body);
+
+  out.u16(static_cast<uint16_t>(models.size()));
+  for (const Model &model : models) {
+    const std::vector<ModelElement> &elements = model.getElements();
+    out.u16(static_cast<uint16_t>(elements.size()));
+    for (const ModelElement &element : elements) {
+      writeVector(out, element.from);
+      writeVector(out, element.to);
+      writeVector(out, element.rotation.origin);
+      out.u16(strings.add(element.rotation.axis));
+      out.f32(element.rotation.angle);
+
+      out.u8(static_cast<uint8_t>(element.faces.size()));
+      for (const auto &[direction, face] : element.faces) {
+        out.u8(static_cast<uint8_t>(parseDirection(direction)));
+        out.f32(face.uv1.x);
+        out.f32(face.uv1.y);
+        out.f32(face.uv2.x);
+        out.f32(face.uv2.y);
+        out.u16(strings.add(face.texture));
+        out.u8(static_cast<uint8_t>(parseDirection(face.cullface)));
+        out.i16(static_cast<int16_t>(face.rotation));
+        out.i8(static_cast<int8_t>(face.tintindex));
+      }
+    }
+  }
+
+  out.u16(static_cast<uint16_t>(blocks.size()));
+  for (const BlockEntry &entry : blocks) {
+    out.u16(strings.add(entry.block));
+    out.u16(static_cast<uint16_t>(entry.model));
+  }
+
+  // The string table goes first, so the reader has it before the models
+  std::vector<uint8_t> header(BUNDLE_MAGIC, BUNDLE_MAGIC + 4);
+  ByteWriter headerOut(header);
+  headerOut.u32(VERSION);
+  headerOut.u16(static_cast<uint16_t>(strings.strings.size()));
+  for (const std::string &value : strings.strings) {
+    headerOut.string(value);
+  }
+
+  std::ofstream file(path, std::ios::binary);
+  if (!file.is_open()) {
+    throw std::runtime_error("failed to create asset bundle: " + path);
+  }
+  file.write(reinterpret_cast<const char *>(header.data()), header.size());
+  file.write(reinterpret_cast<const char *>(body.data()), body.size());
+}
+
+AssetBundle AssetBundle::read(const std::string &path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file.is_open()) {
+    throw std::runtime_error("failed to open asset bundle: " + path);
+  }
+  std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)),
+                            std::istreambuf_iterator<char>());
+
+  if (data.size() < 4 || !std::equal(BUNDLE_MAGIC, BUNDLE_MAGIC + 4,
+                                     data.begin())) {
+    throw std::runtime_error("not an asset bundle: " + path);
+  }
+  ByteReader in(data.data() + 4, data.size() - 4);
+  if (in.u32() != VERSION) {
+    throw std::runtime_error("unsupported asset bundle version: " + path);
+  }
+
+  std::vector<std::string> strings(in.u16());
+  for (std::string &value : strings) {
+    value = in.string();
+  }
+  auto string = [&](uint16_t index) -> const std::string & {
+    if (index >= strings.size()) {
+      throw std::runtime_error("malformed asset bundle: " + path);
+    }
+    return strings[index];
+  };
+
+  AssetBundle bundle;
+  for (uint16_t count = in.u16(); count > 0; --count) {
+    std::vector<ModelElement> elements(in.u16());
+    for (ModelElement &element : elements) {
+      element.from = readVector(in);
+      element.to = readVector(in);
+      element.rotation.origin = readVector(in);
+      element.rotation.axis = string(in.u16());
+      element.rotation.angle = in.f32();
+
+      for (int faces = in.u8(); faces > 0; --faces) {
+        Direction direction = static_cast<Direction>(in.u8());
+        ModelFace face;
+        face.uv1.x = in.f32();
+        face.uv1.y = in.f32();
+        face.uv2.x = in.f32();
+        face.uv2.y = in.f32();
+        face.texture = string(in.u16());
+        Direction cullface = static_cast<Direction>(in.u8());
+        face.rotation = in.i16();
+        face.tintindex = in.i8();
+        if (direction >= Direction::None || cullface > Direction::None) {
+          throw std::runtime_error("malformed asset bundle: " + path);
+        }
+        face.cullface = getName(cullface);
+        element.faces[getName(direction)] = face;
+      }
+    }
+    bundle.models.emplace_back(std::move(elements));
+  }
+
+  for (uint16_t count = in.u16(); count > 0; --count) {
+    BlockEntry entry;
+    entry.block = string(in.u16());
+    entry.model = in.u16();
+    if (entry.model >= bundle.models.size()) {
+      throw std::runtime_error("malformed asset bundle: " + path);
+    }
+    bundle.blocks.push_back(entry);
+  }
+  return bundle;
+}
+
+} // namespace MCPSP
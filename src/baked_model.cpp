@@ -0,0 +1,229 @@
+#include "baked_model.hpp"
+#include <algorithm>
+#include <raymath.h>
+#include <utility>
+
+namespace MCPSP {
+
+static Matrix getElementTransform(const ElementRotation &rotation) {
+  Matrix transform = MatrixIdentity();
+  if (rotation.angle == 0.0f) {
+    return transform;
+  }
+
+  // Apply rotation around the specified axis
+  Vector3 origin = rotation.origin;
+  transform = MatrixTranslate(origin.x, origin.y, origin.z) * transform;
+
+  if (rotation.axis == "x") {
+    transform = MatrixRotateX(rotation.angle * DEG2RAD) * transform;
+  } else if (rotation.axis == "y") {
+    transform = MatrixRotateY(rotation.angle * DEG2RAD) * transform;
+  } else if (rotation.axis == "z") {
+    transform = MatrixRotateZ(rotation.angle * DEG2RAD) * transform;
+  }
+
+  return MatrixTranslate(-origin.x, -origin.y, -origin.z) * transform;
+}
+
+static void rotateUVs(int rotation, Vector2 &uv1, Vector2 &uv2) {
+  if (rotation == 90) {
+    // Rotate UV coordinates 90 degrees clockwise
+    float tempX = uv1.x;
+    uv1.x = uv1.y;
+    uv1.y = uv2.x;
+    uv2.x = uv2.y;
+    uv2.y = tempX;
+  } else if (rotation == 180) {
+    // Rotate UV coordinates 180 degrees
+    std::swap(uv1.x, uv2.x);
+    std::swap(uv1.y, uv2.y);
+  } else if (rotation == 270) {
+    // Rotate UV coordinates 270 degrees clockwise
+    float tempX = uv1.x;
+    uv1.x = uv2.y;
+    uv2.y = uv2.x;
+    uv2.x = uv1.y;
+    uv1.y = tempX;
+  }
+}
+
+// Fills in corner positions for a face, counter-clockwise from top-left.
+static void getFaceCorners(Direction face, Vector3 from, Vector3 to,
+                           Vector3 corners[4]) {
+  switch (face) {
+  case Direction::North: // -Z
+    corners[0] = {from.x, to.y, from.z};
+    corners[1] = {to.x, to.y, from.z};
+    corners[2] = {to.x, from.y, from.z};
+    corners[3] = {from.x, from.y, from.z};
+    break;
+  case Direction::South: // +Z
+    corners[0] = {to.x, to.y, to.z};
+    corners[1] = {from.x, to.y, to.z};
+    corners[2] = {from.x, from.y, to.z};
+    corners[3] = {to.x, from.y, to.z};
+    break;
+  case Direction::East: // +X
+    corners[0] = {to.x, to.y, from.z};
+    corners[1] = {to.x, to.y, to.z};
+    corners[2] = {to.x, from.y, to.z};
+    corners[3] = {to.x, from.y, from.z};
+    break;
+  case Direction::West: // -X
+    corners[0] = {from.x, to.y, to.z};
+    corners[1] = {from.x, to.y, from.z};
+    corners[2] = {from.x, from.y, from.z};
+    corners[3] = {from.x, from.y, to.z};
+    break;
+  case Direction::Up: // +Y
+    corners[0] = {from.x, to.y, from.z};
+    corners[1] = {from.x, to.y, to.z};
+    corners[2] = {to.x, to.y, to.z};
+    corners[3] = {to.x, to.y, from.z};
+    break;
+  case Direction::Down: // -Y
+    corners[0] = {from.x, from.y, to.z};
+    corners[1] = {from.x, from.y, from.z};
+    corners[2] = {to.x, from.y, from.z};
+    corners[3] = {to.x, from.y, to.z};
+    break;
+  case Direction::None:
+    break;
+  }
+}
+
+BakedModel::BakedModel(const Model &model) {
+  for (const auto &element : model.getElements()) {
+    Matrix transform = getElementTransform(element.rotation);
+
+    BoundingBox box = {Vector3Transform(element.from, transform),
+                       Vector3Transform(element.from, transform)};
+    for (int i = 1; i < 8; ++i) {
+      Vector3 corner = Vector3Transform(
+          {i & 1 ? element.to.x : element.from.x,
+           i & 2 ? element.to.y : element.from.y,
+           i & 4 ? element.to.z : element.from.z},
+          transform);
+      box.min = Vector3Min(box.min, corner);
+      box.max = Vector3Max(box.max, corner);
+    }
+    boxes.push_back(box);
+
+    for (const auto &[direction, face] : element.faces) {
+      BakedQuad quad;
+      quad.face = parseDirection(direction);
+      if (quad.face == Direction::None) {
+        continue;
+      }
+      quad.cullface = parseDirection(face.cullface);
+      quad.texture = model.resolveTexture(face.texture);
+      quad.textureHandle = TextureManager::getHandle(quad.texture);
+      quad.layer = TextureManager::getLayer(quad.textureHandle);
+      quad.tintIndex = static_cast<int8_t>(face.tintindex);
+
+      getFaceCorners(quad.face, element.from, element.to, quad.corners);
+      for (Vector3 &corner : quad.corners) {
+        corner = Vector3Transform(corner, transform);
+      }
+
+      Vector2 uv1 = face.uv1;
+      Vector2 uv2 = face.uv2;
+      rotateUVs(face.rotation, uv1, uv2);
+
+      // Side faces run U along the top edge, horizontal faces run V
+      if (quad.face == Direction::Up || quad.face == Direction::Down) {
+        quad.uvs[0] = {uv1.x, uv1.y};
+        quad.uvs[1] = {uv1.x, uv2.y};
+        quad.uvs[2] = {uv2.x, uv2.y};
+        quad.uvs[3] = {uv2.x, uv1.y};
+      } else {
+        quad.uvs[0] = {uv1.x, uv1.y};
+        quad.uvs[1] = {uv2.x, uv1.y};
+        quad.uvs[2] = {uv2.x, uv2.y};
+        quad.uvs[3] = {uv1.x, uv2.y};
+      }
+
+      quad.atlasPage = quad.texture;
+      quad.atlasHandle = quad.textureHandle;
+      for (int i = 0; i < 4; ++i) {
+        quad.atlasUvs[i] = quad.uvs[i];
+      }
+
+      quads.push_back(quad);
+    }
+  }
+
+  for (int face = 0; face < 6; ++face) {
+    if (computeFullFace(static_cast<Direction>(face))) {
+      fullFaces |= 1 << face;
+    }
+  }
+
+  cullable = std::all_of(quads.begin(), quads.end(), [](const BakedQuad &q) {
+    return q.cullface != Direction::None;
+  });
+  opaque = fullFaces == 0x3f &&
+           std::all_of(quads.begin(), quads.end(), [](const BakedQuad &q) {
+             return q.layer == RenderLayer::Solid;
+           });
+}
+
+bool BakedModel::computeFullFace(Direction face) const {
+  int axis = getAxis(face);
+  int u = (axis + 1) % 3;
+  int v = (axis + 2) % 3;
+  float plane = isPositive(face) ? 1.0f : 0.0f;
+
+  bool found = false;
+  for (const BakedQuad &quad : quads) {
+    if (quad.face != face) {
+      continue;
+    }
+    if (quad.cullface != face) {
+      return false;
+    }
+
+    Vector2 uvMin = quad.uvs[0];
+    Vector2 uvMax = quad.uvs[0];
+    int corners = 0;
+    for (int i = 0; i < 4; ++i) {
+      float cu = getComponent(quad.corners[i], u);
+      float cv = getComponent(quad.corners[i], v);
+      if (getComponent(quad.corners[i], axis) != plane) {
+        return false;
+      }
+      if ((cu != 0.0f && cu != 1.0f) || (cv != 0.0f && cv != 1.0f)) {
+        return false;
+      }
+      corners |= 1 << (static_cast<int>(cu) + 2 * static_cast<int>(cv));
+
+      uvMin = {std::min(uvMin.x, quad.uvs[i].x),
+               std::min(uvMin.y, quad.uvs[i].y)};
+      uvMax = {std::max(uvMax.x, quad.uvs[i].x),
+               std::max(uvMax.y, quad.uvs[i].y)};
+    }
+    if (corners != 0xf || uvMin.x != 0.0f || uvMin.y != 0.0f ||
+        uvMax.x != 1.0f || uvMax.y != 1.0f) {
+      return false;
+    }
+    found = true;
+  }
+  return found;
+}
+
+void BakedModel::remapToAtlas(const TextureAtlas &atlas) {
+  for (BakedQuad &quad : quads) {
+    const AtlasRegion *region = atlas.getRegion(quad.texture);
+    if (region == nullptr) {
+      continue;
+    }
+    quad.atlasPage = region->page;
+    quad.atlasHandle = TextureManager::getHandle(region->page);
+    for (int i = 0; i < 4; ++i) {
+      quad.atlasUvs[i] = region->map(quad.uvs[i]);
+    }
+  }
+}
+
+} // namespace MCPSP
@@ -1,22 +1,66 @@
 #include "block_registry.hpp"
+#include "asset_bundle.hpp"
 #include "resource_location.hpp"
-#include <string>
 
 namespace MCPSP {
 
-std::unordered_map<ResourceLocation, Block> BlockRegistry::blocks;
+// Block light levels of vanilla blocks, which model files don't carry
+static const struct {
+  const char *block;
+  uint8_t level;
+} lightEmissions[] = {
+    {"minecraft:torch", 14},        {"minecraft:wall_torch", 14},
+    {"minecraft:lantern", 15},      {"minecraft:glowstone", 15},
+    {"minecraft:sea_lantern", 15},  {"minecraft:jack_o_lantern", 15},
+    {"minecraft:lava", 15},         {"minecraft:redstone_torch", 7},
+};
+
+std::vector<Block> BlockRegistry::blocks(1);
+std::vector<uint16_t> BlockRegistry::slots;
+TextureAtlas BlockRegistry::atlas(ResourceLocation("minecraft:atlas/blocks"));
 
 void BlockRegistry::registerBlock(const ResourceLocation &location,
                                   const Block &block) {
-  blocks[location] = block;
+  uint16_t id = location.getId();
+  if (id >= slots.size()) {
+    slots.resize(id + 1, 0);
+  }
+
+  if (slots[id] == 0) {
+    slots[id] = static_cast<uint16_t>(blocks.size());
+    blocks.emplace_back();
+  }
+
+  Block &registered = blocks[slots[id]];
+  registered = block;
+  registered.bakedModel = BakedModel(block.model);
+
+  std::string name = location;
+  for (const auto &emission : lightEmissions) {
+    if (name == emission.block) {
+      registered.lightEmission = emission.level;
+    }
+  }
+}
+
+void BlockRegistry::registerBundle(const std::string &path) {
+  AssetBundle bundle = AssetBundle::read(path);
+  for (const AssetBundle::BlockEntry &entry : bundle.blocks) {
+    registerBlock(ResourceLocation(entry.block),
+                  Block{bundle.models[entry.model]});
+  }
 }
 
-const Block &BlockRegistry::getBlock(const ResourceLocation &location) {
-  auto it = blocks.find(location);
-  if (it != blocks.end()) {
-    return it->second;
-  } else {
-    throw std::runtime_error("Block not found: " + (std::string)location);
+void BlockRegistry::stitchTextures() {
+  for (const Block &block : blocks) {
+    for (const BakedQuad &quad : block.bakedModel.getQuads()) {
+      atlas.addTexture(quad.texture);
+    }
+  }
+  atlas.stitch();
+
+  for (Block &block : blocks) {
+    block.bakedModel.remapToAtlas(atlas);
   }
 }
 
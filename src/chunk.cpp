@@ -1,463 +1,258 @@
 #include "chunk.hpp"
 #include "block_registry.hpp"
+#include "mesh_worker.hpp"
+#include "render_list.hpp"
 #include "raylib.h"
 #include "resource_location.hpp"
-#include "rlgl.h"
-#include "texture_manager.hpp"
 #include "world.hpp"
-#include <GL/gl.h>
-#include <raymath.h>
+#include <algorithm>
+#include <stdexcept>
 
 namespace MCPSP {
 
-// TODO: Not hardcode tint colors
-static Color tint_colors[] = {
-    {0x91, 0xbd, 0x59, 255}, // Grass
-    {0x77, 0xab, 0x2f, 255}, // Foliage
-    {0xa3, 0x75, 0x46, 255}, // Dry Foliage
-    {0x3f, 0x76, 0xe4, 255}, // Water
-};
+MeshingMode Chunk::meshingMode = MeshingMode::Naive;
 
-void Chunk::generateMesh() {
-  meshes.clear();
+void Chunk::setBlock(int x, int y, int z, const BlockState &state) {
+  int sectionY = y / ChunkSection::SIZE;
+  int localY = y % ChunkSection::SIZE;
+  BlockState old = sections[sectionY].getBlock(x, localY, z);
+  if (!sections[sectionY].setBlock(x, localY, z, state)) {
+    return;
+  }
+  modified = true;
+  markBlockDirty(x, y, z);
+
+  if (world == nullptr) {
+    return;
+  }
+  world->getLightEngine().onBlockChanged(chunkX * 16 + x, y, chunkZ * 16 + z,
+                                         old);
+}
 
-  for (int x = 0; x < 16; ++x) {
-    for (int y = 0; y < 64; ++y) {
-      for (int z = 0; z < 16; ++z) {
-        BlockState &blockState = blocks[x][y][z];
-        if (blockState.block != ResourceLocation("minecraft:air")) {
-          Vector3 position = {static_cast<float>(x), static_cast<float>(y),
-                              static_cast<float>(z)};
-          generateBlockMesh(blockState, position);
+void Chunk::markBlockDirty(int x, int y, int z) {
+  int sectionY = y / ChunkSection::SIZE;
+  int localY = y % ChunkSection::SIZE;
+  int minX = x == 0 ? -1 : 0, maxX = x == 15 ? 1 : 0;
+  int minY = localY == 0 ? -1 : 0, maxY = localY == ChunkSection::SIZE - 1;
+  int minZ = z == 0 ? -1 : 0, maxZ = z == 15 ? 1 : 0;
+
+  for (int dz = minZ; dz <= maxZ; ++dz) {
+    for (int dx = minX; dx <= maxX; ++dx) {
+      Chunk *target = this;
+      if (dx != 0 || dz != 0) {
+        target = world == nullptr ? nullptr
+                                  : world->getChunk(chunkX + dx, chunkZ + dz);
+        if (target == nullptr) {
+          continue;
         }
       }
+      for (int dy = minY; dy <= maxY; ++dy) {
+        target->markSectionDirty(sectionY + dy);
+      }
     }
   }
 }
 
-void Chunk::generateBlockMesh(const BlockState &blockState, Vector3 position) {
-  const Block &block = BlockRegistry::getBlock(blockState.block);
-  const Model &model = block.model;
-
-  // Extract block coordinates within this chunk
-  int blockX = static_cast<int>(position.x);
-  int blockY = static_cast<int>(position.y);
-  int blockZ = static_cast<int>(position.z);
-
-  for (const auto &element : model.getElements()) {
-    Vector3 from = element.from;
-    Vector3 to = element.to;
-
-    Matrix transform = MatrixIdentity();
+void Chunk::write(ByteWriter &out) const {
+  out.u8(SECTION_COUNT);
+  for (const ChunkSection &section : sections) {
+    section.write(out);
+  }
 
-    // Apply element rotation if specified
-    if (element.rotation.angle != 0.0f) {
-      Vector3 origin = element.rotation.origin;
+  std::vector<TickScheduler::SavedTick> ticks;
+  if (world != nullptr) {
+    world->getTickScheduler().getChunkTicks({chunkX, chunkZ}, ticks);
+  }
+  out.u32(static_cast<uint32_t>(ticks.size()));
+  for (const TickScheduler::SavedTick &tick : ticks) {
+    out.u16(tick.index);
+    out.u32(tick.delay);
+    out.string(tick.block);
+  }
+}
 
-      // Apply rotation around the specified axis
-      transform = MatrixTranslate(origin.x, origin.y, origin.z) * transform;
+void Chunk::read(ByteReader &in) {
+  if (in.u8() != SECTION_COUNT) {
+    throw std::runtime_error("chunk has the wrong number of sections");
+  }
+  for (ChunkSection &section : sections) {
+    section.read(in);
+  }
 
-      if (element.rotation.axis == "x") {
-        transform = MatrixRotateX(element.rotation.angle * DEG2RAD) * transform;
-      } else if (element.rotation.axis == "y") {
-        transform = MatrixRotateY(element.rotation.angle * DEG2RAD) * transform;
-      } else if (element.rotation.axis == "z") {
-        transform = MatrixRotateZ(element.rotation.angle * DEG2RAD) * transform;
+  // Chunks saved before ticks were scheduled end after their sections
+  std::vector<TickScheduler::SavedTick> ticks;
+  if (!in.atEnd()) {
+    for (uint32_t count = in.u32(); count > 0; --count) {
+      TickScheduler::SavedTick tick;
+      tick.index = in.u16();
+      tick.delay = in.u32();
+      tick.block = ResourceLocation(in.string());
+      if (tick.index >= 16 * HEIGHT * 16) {
+        throw std::runtime_error("scheduled tick outside the chunk");
       }
-
-      transform = MatrixTranslate(-origin.x, -origin.y, -origin.z) * transform;
+      ticks.push_back(tick);
     }
+  }
+  if (!in.atEnd()) {
+    throw std::runtime_error("trailing data after chunk");
+  }
 
-    // Generate mesh for each face
-    for (const auto &[direction, face] : element.faces) {
-      // Skip face if it should be culled based on the cullface property
-      if (!face.cullface.empty()) {
-        bool shouldCull = false;
-
-        // Determine neighboring block position based on cullface direction
-        int nx = blockX;
-        int ny = blockY;
-        int nz = blockZ;
-
-        if (face.cullface == "north")
-          nz -= 1;
-        else if (face.cullface == "south")
-          nz += 1;
-        else if (face.cullface == "east")
-          nx += 1;
-        else if (face.cullface == "west")
-          nx -= 1;
-        else if (face.cullface == "up")
-          ny += 1;
-        else if (face.cullface == "down")
-          ny -= 1;
-
-        // Check if neighboring position is within this chunk
-        if (nx >= 0 && nx < 16 && ny >= 0 && ny < 64 && nz >= 0 && nz < 16) {
-          // Check if neighboring block in this chunk is solid (not air)
-          if (blocks[nx][ny][nz].block != ResourceLocation("minecraft:air")) {
-            shouldCull = true;
-          }
-        }
-        // If the neighbor is outside this chunk's boundaries, check neighboring
-        // chunks
-        else {
-          // Calculate which neighboring chunk to check and local coordinates
-          // within that chunk
-          int chunkOffsetX = 0;
-          int chunkOffsetZ = 0;
-          int localX = nx;
-          int localZ = nz;
-
-          // Handle x-axis chunk boundaries
-          if (nx < 0) {
-            chunkOffsetX = -1;
-            localX = 15; // Wrap to the far edge of the neighboring chunk
-          } else if (nx >= 16) {
-            chunkOffsetX = 1;
-            localX = 0; // Wrap to the near edge of the neighboring chunk
-          }
-
-          // Handle z-axis chunk boundaries
-          if (nz < 0) {
-            chunkOffsetZ = -1;
-            localZ = 15; // Wrap to the far edge of the neighboring chunk
-          } else if (nz >= 16) {
-            chunkOffsetZ = 1;
-            localZ = 0; // Wrap to the near edge of the neighboring chunk
-          }
+  // Only scheduled once the whole chunk has read successfully
+  if (world != nullptr) {
+    for (const TickScheduler::SavedTick &tick : ticks) {
+      world->getTickScheduler().schedule(
+          {{chunkX, chunkZ}, tick.index, tick.block}, tick.delay);
+    }
+  }
+}
 
-          // Only check neighboring chunks if we're at a horizontal boundary
-          // (y-axis doesn't cross chunks)
-          if (chunkOffsetX != 0 || chunkOffsetZ != 0) {
-            // If world is available, check the neighboring chunk
-            if (world != nullptr) {
-              // Calculate the actual chunk coordinates
-              int neighborChunkX = chunkX + chunkOffsetX;
-              int neighborChunkZ = chunkZ + chunkOffsetZ;
+bool Chunk::isSectionEnclosed(int sectionY) const {
+  if (!sections[sectionY].isAllCullable() || sectionY == 0 ||
+      sectionY == SECTION_COUNT - 1 || world == nullptr) {
+    return false;
+  }
+  if (!sections[sectionY - 1].isAllSolid() ||
+      !sections[sectionY + 1].isAllSolid()) {
+    return false;
+  }
 
-              // Get the neighboring chunk from the world
-              const Chunk *neighborChunk =
-                  world->getChunk(neighborChunkX, neighborChunkZ);
+  static const int neighbors[4][2] = {{-1, 0}, {1, 0}, {0, -1}, {0, 1}};
+  for (const auto &offset : neighbors) {
+    const Chunk *neighbor =
+        world->getChunk(chunkX + offset[0], chunkZ + offset[1]);
+    if (neighbor == nullptr ||
+        !neighbor->sections[sectionY].isAllSolid()) {
+      return false;
+    }
+  }
+  return true;
+}
 
-              if (neighborChunk != nullptr) {
-                // Check the block in the neighboring chunk
-                BlockState neighborBlock =
-                    neighborChunk->getBlock(localX, ny, localZ);
-                if (neighborBlock.block != ResourceLocation("minecraft:air")) {
-                  shouldCull = true;
-                }
-              } else {
-                // If the neighboring chunk doesn't exist, we probably can't
-                // see the edge anyway. Set to false for out-of-bounds view
-                shouldCull = false;
-              }
-            }
-          } else if (ny < 0 || ny >= 64) {
-            // For y-axis boundaries, simply treat out-of-bounds as air
-            // (could be modified for future vertical chunk support)
-            shouldCull = false;
-          }
-        }
+SectionSnapshot Chunk::takeSnapshot(int sectionY) const {
+  SectionSnapshot snapshot;
+  snapshot.enclosed = isSectionEnclosed(sectionY);
+  snapshot.mode = meshingMode;
+  if (snapshot.enclosed) {
+    // Nothing will be meshed, so the blocks aren't needed
+    return snapshot;
+  }
 
-        // Skip this face if it's culled
-        if (shouldCull) {
-          continue;
-        }
+  // Copy this section and the border of all 26 surrounding ones, looking
+  // each chunk up only once
+  for (int dz = -1; dz <= 1; ++dz) {
+    for (int dx = -1; dx <= 1; ++dx) {
+      const Chunk *source = this;
+      if (dx != 0 || dz != 0) {
+        source = world != nullptr
+                     ? world->getChunk(chunkX + dx, chunkZ + dz)
+                     : nullptr;
       }
-
-      ResourceLocation texture = model.resolveTexture(face.texture);
-      if (meshes.find(texture) == meshes.end()) {
-        meshes[texture] = Mesh();
+      if (source == nullptr) {
+        continue;
       }
-      Mesh &mesh = meshes[texture];
 
-      Vector2 uv1 = face.uv1;
-      Vector2 uv2 = face.uv2;
-      Color tint_color;
-      if (face.tintindex != -1) {
-        // Use the tint color based on the tintindex
-        if (face.tintindex >= 0 && face.tintindex < 4) {
-          tint_color = tint_colors[face.tintindex];
-        } else {
-          tint_color = WHITE; // Default to white if index is out of bounds
+      for (int dy = -1; dy <= 1; ++dy) {
+        int sourceY = sectionY + dy;
+        if (sourceY < 0 || sourceY >= SECTION_COUNT) {
+          continue;
         }
-      } else {
-        tint_color = WHITE; // Default to white if no tint index
-      }
-
-      // Apply face rotation if specified
-      if (face.rotation != 0) {
-        if (face.rotation == 90) {
-          // Rotate UV coordinates 90 degrees clockwise
-          float tempX = uv1.x;
-          uv1.x = uv1.y;
-          uv1.y = uv2.x;
-          uv2.x = uv2.y;
-          uv2.y = tempX;
-        } else if (face.rotation == 180) {
-          // Rotate UV coordinates 180 degrees
-          std::swap(uv1.x, uv2.x);
-          std::swap(uv1.y, uv2.y);
-        } else if (face.rotation == 270) {
-          // Rotate UV coordinates 270 degrees clockwise
-          float tempX = uv1.x;
-          uv1.x = uv2.y;
-          uv2.y = uv2.x;
-          uv2.x = uv1.y;
-          uv1.y = tempX;
+        // Air sections still hold light
+        snapshot.copyLightFrom(source->sections[sourceY], dx, dy, dz);
+        if (!source->sections[sourceY].isAllAir()) {
+          snapshot.copyFrom(source->sections[sourceY], dx, dy, dz);
         }
       }
-
-      // Create vertices based on direction
-      if (direction == "north") {
-        // North face (-Z): Counter-clockwise from top-left
-        Vector3 v1 = {from.x, to.y, from.z};   // Top-left
-        Vector3 v2 = {to.x, to.y, from.z};     // Top-right
-        Vector3 v3 = {to.x, from.y, from.z};   // Bottom-right
-        Vector3 v4 = {from.x, from.y, from.z}; // Bottom-left
-
-        // Apply transformation
-        v1 = Vector3Transform(v1, transform);
-        v2 = Vector3Transform(v2, transform);
-        v3 = Vector3Transform(v3, transform);
-        v4 = Vector3Transform(v4, transform);
-
-        // Translate to block position
-        v1 = {v1.x + position.x, v1.y + position.y, v1.z + position.z};
-        v2 = {v2.x + position.x, v2.y + position.y, v2.z + position.z};
-        v3 = {v3.x + position.x, v3.y + position.y, v3.z + position.z};
-        v4 = {v4.x + position.x, v4.y + position.y, v4.z + position.z};
-
-        // Add first triangle (v1, v2, v3)
-        mesh.vertices.push_back(v1);
-        mesh.vertices.push_back(v2);
-        mesh.vertices.push_back(v3);
-        mesh.uvs.push_back({uv1.x, uv1.y});
-        mesh.uvs.push_back({uv2.x, uv1.y});
-        mesh.uvs.push_back({uv2.x, uv2.y});
-
-        // Add second triangle (v1, v3, v4)
-        mesh.vertices.push_back(v1);
-        mesh.vertices.push_back(v3);
-        mesh.vertices.push_back(v4);
-        mesh.uvs.push_back({uv1.x, uv1.y});
-        mesh.uvs.push_back({uv2.x, uv2.y});
-        mesh.uvs.push_back({uv1.x, uv2.y});
-      } else if (direction == "south") {
-        // South face (+Z): Counter-clockwise from top-left
-        Vector3 v1 = {to.x, to.y, to.z};     // Top-left
-        Vector3 v2 = {from.x, to.y, to.z};   // Top-right
-        Vector3 v3 = {from.x, from.y, to.z}; // Bottom-right
-        Vector3 v4 = {to.x, from.y, to.z};   // Bottom-left
-
-        // Apply transformation
-        v1 = Vector3Transform(v1, transform);
-        v2 = Vector3Transform(v2, transform);
-        v3 = Vector3Transform(v3, transform);
-        v4 = Vector3Transform(v4, transform);
-
-        // Translate to block position
-        v1 = {v1.x + position.x, v1.y + position.y, v1.z + position.z};
-        v2 = {v2.x + position.x, v2.y + position.y, v2.z + position.z};
-        v3 = {v3.x + position.x, v3.y + position.y, v3.z + position.z};
-        v4 = {v4.x + position.x, v4.y + position.y, v4.z + position.z};
-
-        // Add triangles
-        mesh.vertices.push_back(v1);
-        mesh.vertices.push_back(v2);
-        mesh.vertices.push_back(v3);
-        mesh.uvs.push_back({uv1.x, uv1.y});
-        mesh.uvs.push_back({uv2.x, uv1.y});
-        mesh.uvs.push_back({uv2.x, uv2.y});
-
-        mesh.vertices.push_back(v1);
-        mesh.vertices.push_back(v3);
-        mesh.vertices.push_back(v4);
-        mesh.uvs.push_back({uv1.x, uv1.y});
-        mesh.uvs.push_back({uv2.x, uv2.y});
-        mesh.uvs.push_back({uv1.x, uv2.y});
-      } else if (direction == "east") {
-        // East face (+X): Counter-clockwise from top-left
-        Vector3 v1 = {to.x, to.y, from.z};   // Top-left
-        Vector3 v2 = {to.x, to.y, to.z};     // Top-right
-        Vector3 v3 = {to.x, from.y, to.z};   // Bottom-right
-        Vector3 v4 = {to.x, from.y, from.z}; // Bottom-left
-
-        // Apply transformation
-        v1 = Vector3Transform(v1, transform);
-        v2 = Vector3Transform(v2, transform);
-        v3 = Vector3Transform(v3, transform);
-        v4 = Vector3Transform(v4, transform);
-
-        // Translate to block position
-        v1 = {v1.x + position.x, v1.y + position.y, v1.z + position.z};
-        v2 = {v2.x + position.x, v2.y + position.y, v2.z + position.z};
-        v3 = {v3.x + position.x, v3.y + position.y, v3.z + position.z};
-        v4 = {v4.x + position.x, v4.y + position.y, v4.z + position.z};
-
-        // Add triangles
-        mesh.vertices.push_back(v1);
-        mesh.vertices.push_back(v2);
-        mesh.vertices.push_back(v3);
-        mesh.uvs.push_back({uv1.x, uv1.y});
-        mesh.uvs.push_back({uv2.x, uv1.y});
-        mesh.uvs.push_back({uv2.x, uv2.y});
-
-        mesh.vertices.push_back(v1);
-        mesh.vertices.push_back(v3);
-        mesh.vertices.push_back(v4);
-        mesh.uvs.push_back({uv1.x, uv1.y});
-        mesh.uvs.push_back({uv2.x, uv2.y});
-        mesh.uvs.push_back({uv1.x, uv2.y});
-      } else if (direction == "west") {
-        // West face (-X): Counter-clockwise from top-left
-        Vector3 v1 = {from.x, to.y, to.z};     // Top-left
-        Vector3 v2 = {from.x, to.y, from.z};   // Top-right
-        Vector3 v3 = {from.x, from.y, from.z}; // Bottom-right
-        Vector3 v4 = {from.x, from.y, to.z};   // Bottom-left
-
-        // Apply transformation
-        v1 = Vector3Transform(v1, transform);
-        v2 = Vector3Transform(v2, transform);
-        v3 = Vector3Transform(v3, transform);
-        v4 = Vector3Transform(v4, transform);
-
-        // Translate to block position
-        v1 = {v1.x + position.x, v1.y + position.y, v1.z + position.z};
-        v2 = {v2.x + position.x, v2.y + position.y, v2.z + position.z};
-        v3 = {v3.x + position.x, v3.y + position.y, v3.z + position.z};
-        v4 = {v4.x + position.x, v4.y + position.y, v4.z + position.z};
-
-        // Add triangles
-        mesh.vertices.push_back(v1);
-        mesh.vertices.push_back(v2);
-        mesh.vertices.push_back(v3);
-        mesh.uvs.push_back({uv1.x, uv1.y});
-        mesh.uvs.push_back({uv2.x, uv1.y});
-        mesh.uvs.push_back({uv2.x, uv2.y});
-
-        mesh.vertices.push_back(v1);
-        mesh.vertices.push_back(v3);
-        mesh.vertices.push_back(v4);
-        mesh.uvs.push_back({uv1.x, uv1.y});
-        mesh.uvs.push_back({uv2.x, uv2.y});
-        mesh.uvs.push_back({uv1.x, uv2.y});
-      } else if (direction == "up") {
-        // Up face (+Y): Counter-clockwise from top-left
-        Vector3 v1 = {from.x, to.y, from.z}; // Top-left
-        Vector3 v2 = {from.x, to.y, to.z};   // Top-right
-        Vector3 v3 = {to.x, to.y, to.z};     // Bottom-right
-        Vector3 v4 = {to.x, to.y, from.z};   // Bottom-left
-
-        // Apply transformation
-        v1 = Vector3Transform(v1, transform);
-        v2 = Vector3Transform(v2, transform);
-        v3 = Vector3Transform(v3, transform);
-        v4 = Vector3Transform(v4, transform);
-
-        // Translate to block position
-        v1 = {v1.x + position.x, v1.y + position.y, v1.z + position.z};
-        v2 = {v2.x + position.x, v2.y + position.y, v2.z + position.z};
-        v3 = {v3.x + position.x, v3.y + position.y, v3.z + position.z};
-        v4 = {v4.x + position.x, v4.y + position.y, v4.z + position.z};
-
-        // Add triangles
-        mesh.vertices.push_back(v1);
-        mesh.vertices.push_back(v2);
-        mesh.vertices.push_back(v3);
-        mesh.uvs.push_back({uv1.x, uv1.y});
-        mesh.uvs.push_back({uv1.x, uv2.y});
-        mesh.uvs.push_back({uv2.x, uv2.y});
-
-        mesh.vertices.push_back(v1);
-        mesh.vertices.push_back(v3);
-        mesh.vertices.push_back(v4);
-        mesh.uvs.push_back({uv1.x, uv1.y});
-        mesh.uvs.push_back({uv2.x, uv2.y});
-        mesh.uvs.push_back({uv2.x, uv1.y});
-      } else if (direction == "down") {
-        // Down face (-Y): Counter-clockwise from top-left
-        Vector3 v1 = {from.x, from.y, to.z};   // Top-left
-        Vector3 v2 = {from.x, from.y, from.z}; // Top-right
-        Vector3 v3 = {to.x, from.y, from.z};   // Bottom-right
-        Vector3 v4 = {to.x, from.y, to.z};     // Bottom-left
-
-        // Apply transformation
-        v1 = Vector3Transform(v1, transform);
-        v2 = Vector3Transform(v2, transform);
-        v3 = Vector3Transform(v3, transform);
-        v4 = Vector3Transform(v4, transform);
-
-        // Translate to block position
-        v1 = {v1.x + position.x, v1.y + position.y, v1.z + position.z};
-        v2 = {v2.x + position.x, v2.y + position.y, v2.z + position.z};
-        v3 = {v3.x + position.x, v3.y + position.y, v3.z + position.z};
-        v4 = {v4.x + position.x, v4.y + position.y, v4.z + position.z};
-
-        // Add triangles
-        mesh.vertices.push_back(v1);
-        mesh.vertices.push_back(v2);
-        mesh.vertices.push_back(v3);
-        mesh.uvs.push_back({uv1.x, uv1.y});
-        mesh.uvs.push_back({uv1.x, uv2.y});
-        mesh.uvs.push_back({uv2.x, uv2.y});
-
-        mesh.vertices.push_back(v1);
-        mesh.vertices.push_back(v3);
-        mesh.vertices.push_back(v4);
-        mesh.uvs.push_back({uv1.x, uv1.y});
-        mesh.uvs.push_back({uv2.x, uv2.y});
-        mesh.uvs.push_back({uv2.x, uv1.y});
-      }
-
-      // Set color for the mesh
-      mesh.colors.push_back(tint_color);
-      mesh.colors.push_back(tint_color);
-      mesh.colors.push_back(tint_color);
-      mesh.colors.push_back(tint_color);
-      mesh.colors.push_back(tint_color);
-      mesh.colors.push_back(tint_color);
     }
   }
+  return snapshot;
 }
 
-void Chunk::draw(const Vector3 &position) {
-  if (dirty) {
-    generateMesh();
-    dirty = false;
-  }
-
-  rlPushMatrix();
-  rlTranslatef(position.x, position.y, position.z);
+void Chunk::queueMeshing(MeshWorker &worker, uint32_t &nextTicket,
+                         int &budget) {
+  for (int sectionY = 0; sectionY < SECTION_COUNT && budget > 0; ++sectionY) {
+    ChunkSection &section = sections[sectionY];
+    // Sections still being meshed are requeued once their result is in
+    if (!section.dirty || section.meshTicket != 0) {
+      continue;
+    }
+    section.dirty = false;
 
-  for (const auto &[texture, mesh] : meshes) {
-    const Texture2D &tex = TextureManager::getTexture(texture);
-    rlSetTexture(tex.id);
+    // Empty sections need no worker round trip
+    if (section.isAllAir()) {
+      section.setMeshes({});
+      section.visibility = SectionVisibility::all();
+      continue;
+    }
 
-    // Enable alpha testing for transparency
-    glEnable(GL_ALPHA_TEST);
-    glAlphaFunc(GL_GREATER, 0.1f); // Discard pixels with alpha < 0.1
+    --budget;
+    section.meshTicket = ++nextTicket;
+    worker.submit({{chunkX, chunkZ},
+                   sectionY,
+                   section.meshTicket,
+                   takeSnapshot(sectionY)});
+  }
+}
 
-    glEnableClientState(GL_VERTEX_ARRAY);
-    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
-    glEnableClientState(GL_COLOR_ARRAY);
+bool Chunk::applyMesh(MeshResult &result) {
+  ChunkSection &section = sections[result.sectionY];
+  // Results for a chunk that has since been replaced are dropped
+  if (result.ticket != section.meshTicket) {
+    return false;
+  }
+  section.setMeshes(std::move(result.meshes));
+  section.visibility = result.visibility;
+  section.meshTicket = 0;
+  return true;
+}
 
-    glVertexPointer(3, GL_FLOAT, 0, mesh.vertices.data());
-    glTexCoordPointer(2, GL_FLOAT, 0, mesh.uvs.data());
-    glColorPointer(4, GL_UNSIGNED_BYTE, 0, mesh.colors.data());
-    glDrawArrays(GL_TRIANGLES, 0, mesh.vertices.size());
+void Chunk::releaseMeshes() {
+  for (ChunkSection &section : sections) {
+    section.setMeshes({});
+  }
+}
 
-    glDisableClientState(GL_VERTEX_ARRAY);
-    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
-    glDisableClientState(GL_COLOR_ARRAY);
+void Chunk::queueDraws(const Vector3 &position, const Frustum &frustum,
+                       uint32_t reachable, const Vector3 &camera,
+                       RenderList &list, DrawStats &stats) const {
+  for (int sectionY = 0; sectionY < SECTION_COUNT; ++sectionY) {
+    const ChunkSection &section = sections[sectionY];
+    std::size_t triangles = section.getVertexCount() / 2;
+    if (triangles == 0) {
+      continue;
+    }
 
-    // Disable alpha testing when done
-    glDisable(GL_ALPHA_TEST);
-    rlSetTexture(0);
+    Vector3 min = {position.x, position.y + sectionY * ChunkSection::SIZE,
+                   position.z};
+    Vector3 max = {min.x + ChunkSection::SIZE, min.y + ChunkSection::SIZE,
+                   min.z + ChunkSection::SIZE};
+    if (!frustum.isBoxVisible(min, max)) {
+      ++stats.sectionsCulled;
+      stats.trianglesCulled += triangles;
+      continue;
+    }
+    if (!(reachable >> sectionY & 1)) {
+      ++stats.sectionsOccluded;
+      stats.trianglesOccluded += triangles;
+      continue;
+    }
+    ++stats.sectionsDrawn;
+    stats.trianglesDrawn += triangles;
+
+    float half = ChunkSection::SIZE / 2.0f;
+    float dx = min.x + half - camera.x;
+    float dy = min.y + half - camera.y;
+    float dz = min.z + half - camera.z;
+    float distance = dx * dx + dy * dy + dz * dz;
+
+    // Keeps drawing the previous mesh until a rebuilt one is applied
+    static const uint8_t layerStates[RENDER_LAYER_COUNT] = {
+        0, RENDER_ALPHA_TEST, RENDER_BLEND};
+    for (int layer = 0; layer < RENDER_LAYER_COUNT; ++layer) {
+      for (const auto &[texture, mesh] : section.meshes[layer]) {
+        list.add(layerStates[layer], texture, mesh, min, distance);
+      }
+    }
   }
-
-  rlPopMatrix();
 }
 
 } // namespace MCPSP
@@ -0,0 +1,465 @@
+#include "chunk_mesher.hpp"
+#include "block_registry.hpp"
+#include "raylib.h"
+#include <algorithm>
+
+namespace MCPSP {
+
+// TODO: Not hardcode tint colors
+static Color tint_colors[] = {
+    {0x91, 0xbd, 0x59, 255}, // Grass
+    {0x77, 0xab, 0x2f, 255}, // Foliage
+    {0xa3, 0x75, 0x46, 255}, // Dry Foliage
+    {0x3f, 0x76, 0xe4, 255}, // Water
+};
+
+static Color getTintColor(int tintIndex) {
+  // Default to white if there is no tint index or it is out of bounds
+  if (tintIndex >= 0 && tintIndex < 4) {
+    return tint_colors[tintIndex];
+  }
+  return WHITE;
+}
+
+static Color shadeColor(Color color, uint8_t shade) {
+  return {static_cast<unsigned char>(color.r * shade / 255),
+          static_cast<unsigned char>(color.g * shade / 255),
+          static_cast<unsigned char>(color.b * shade / 255), color.a};
+}
+
+static void addQuad(Mesh &mesh, const Vector3 vertices[4],
+                    const Vector2 uvs[4], const Color colors[4]) {
+  for (int i = 0; i < 4; ++i) {
+    mesh.vertices.push_back(encodeVertex(vertices[i], uvs[i], colors[i]));
+  }
+}
+
+// Light levels look evenly spaced when brightness falls off faster than
+// linearly. Level 0 is kept slightly above black.
+static float getBrightness(float level) {
+  float f = level / 15.0f;
+  return 0.1f + 0.9f * f / (4.0f - 3.0f * f);
+}
+
+// Darkening for 0 to 3 open blocks around a corner
+static const float AO_FACTORS[4] = {0.45f, 0.6f, 0.8f, 1.0f};
+
+void SectionSnapshot::copyFrom(const ChunkSection &source, int dx, int dy,
+                               int dz) {
+  const int size = ChunkSection::SIZE;
+  const PalettedContainer<BlockState> &blocks = source.getBlocks();
+  const std::vector<BlockState> &sourcePalette = blocks.getPalette();
+
+  // Source palette index to snapshot palette index, 0 until first seen
+  std::vector<uint16_t> remap(sourcePalette.size(), 0);
+  auto map = [&](uint32_t index) -> uint16_t {
+    if (index == 0 || remap[index] != 0) {
+      return remap[index];
+    }
+    auto it = std::find(palette.begin(), palette.end(), sourcePalette[index]);
+    remap[index] = static_cast<uint16_t>(it - palette.begin());
+    if (it == palette.end()) {
+      palette.push_back(sourcePalette[index]);
+    }
+    return remap[index];
+  };
+
+  // Range of snapshot coordinates covered along each axis: the padding layer
+  // for neighbours, the whole section for the section itself
+  auto begin = [&](int d) { return d < 0 ? -1 : (d > 0 ? size : 0); };
+  auto end = [&](int d) { return d < 0 ? 0 : (d > 0 ? size + 1 : size); };
+
+  for (int y = begin(dy); y < end(dy); ++y) {
+    for (int z = begin(dz); z < end(dz); ++z) {
+      for (int x = begin(dx); x < end(dx); ++x) {
+        uint32_t index = blocks.getIndex(ChunkSection::blockIndex(
+            (x + size) % size, (y + size) % size, (z + size) % size));
+        cells[cellIndex(x, y, z)] = map(index);
+      }
+    }
+  }
+}
+
+void SectionSnapshot::copyLightFrom(const ChunkSection &source, int dx, int dy,
+                                    int dz) {
+  const int size = ChunkSection::SIZE;
+  auto begin = [&](int d) { return d < 0 ? -1 : (d > 0 ? size : 0); };
+  auto end = [&](int d) { return d < 0 ? 0 : (d > 0 ? size + 1 : size); };
+
+  for (int y = begin(dy); y < end(dy); ++y) {
+    for (int z = begin(dz); z < end(dz); ++z) {
+      for (int x = begin(dx); x < end(dx); ++x) {
+        std::size_t index = ChunkSection::blockIndex(
+            (x + size) % size, (y + size) % size, (z + size) % size);
+        light[cellIndex(x, y, z)] = static_cast<uint8_t>(
+            source.getLight(LightChannel::Sky, index) << 4 |
+            source.getLight(LightChannel::Block, index));
+      }
+    }
+  }
+}
+
+MeshSet ChunkMesher::generate(const SectionSnapshot &snapshot) {
+  ChunkMesher mesher(snapshot);
+
+  // Sections buried in solid sections produce no geometry at all
+  if (snapshot.enclosed) {
+    return {};
+  }
+
+  // Resolve each palette entry to its block once, instead of once per block
+  const std::vector<BlockState> &palette = snapshot.palette;
+  mesher.paletteBlocks.assign(palette.size(), nullptr);
+  mesher.paletteOpaque.assign(palette.size(), false);
+  for (std::size_t i = 1; i < palette.size(); ++i) {
+    mesher.paletteBlocks[i] = &BlockRegistry::getBlock(palette[i].block);
+    mesher.paletteOpaque[i] = mesher.paletteBlocks[i]->bakedModel.isOpaque();
+  }
+
+  for (int y = 0; y < ChunkSection::SIZE; ++y) {
+    for (int z = 0; z < ChunkSection::SIZE; ++z) {
+      for (int x = 0; x < ChunkSection::SIZE; ++x) {
+        uint16_t index = snapshot.cells[SectionSnapshot::cellIndex(x, y, z)];
+        if (index != 0) {
+          mesher.generateBlockMesh(*mesher.paletteBlocks[index], x, y, z);
+        }
+      }
+    }
+  }
+
+  if (snapshot.mode == MeshingMode::Greedy) {
+    mesher.generateGreedyMesh();
+  }
+
+  return std::move(mesher.meshes);
+}
+
+uint8_t ChunkMesher::computeShade(int cell, Direction face,
+                                  const Vector3 &corner) const {
+  int samples[4] = {cell, cell, cell, cell};
+  int sampleCount = 1;
+  int ao = 3;
+  if (face != Direction::None) {
+    const float position[3] = {corner.x, corner.y, corner.z};
+    int n = getAxis(face);
+    int u = (n + 1) % 3;
+    int v = (n + 2) % 3;
+    DirectionOffset offset = getOffset(face);
+    bool positive = offset.x + offset.y + offset.z > 0;
+
+    // Faces on the block's boundary are lit from the block they face, inset
+    // faces from the block itself
+    int base = cell;
+    if (position[n] == (positive ? 1.0f : 0.0f)) {
+      base += faceOffsets[static_cast<int>(face)];
+    }
+    int side1 = base + (position[u] < 0.5f ? -1 : 1) * axisOffsets[u];
+    int side2 = base + (position[v] < 0.5f ? -1 : 1) * axisOffsets[v];
+    int diagonal = side1 + side2 - base;
+
+    bool opaque1 = isOpaque(side1);
+    bool opaque2 = isOpaque(side2);
+    bool opaqueDiagonal = isOpaque(diagonal);
+    ao = opaque1 && opaque2 ? 0 : 3 - opaque1 - opaque2 - opaqueDiagonal;
+
+    samples[0] = base;
+    if (!opaque1) {
+      samples[sampleCount++] = side1;
+    }
+    if (!opaque2) {
+      samples[sampleCount++] = side2;
+    }
+    // Light doesn't leak in through the gap between two opaque sides
+    if (!opaqueDiagonal && ao > 0) {
+      samples[sampleCount++] = diagonal;
+    }
+  }
+
+  int sky = 0;
+  int block = 0;
+  for (int i = 0; i < sampleCount; ++i) {
+    uint8_t light = snapshot.light[samples[i]];
+    sky += light >> 4;
+    block += light & 15;
+  }
+  float level = static_cast<float>(std::max(sky, block)) / sampleCount;
+  return static_cast<uint8_t>(getBrightness(level) * AO_FACTORS[ao] * 255.0f +
+                              0.5f);
+}
+
+void ChunkMesher::addBlockQuad(const BakedQuad &quad, int x, int y, int z) {
+  int cell = SectionSnapshot::cellIndex(x, y, z);
+
+  // Translate corners to block position
+  Vector3 vertices[4];
+  Color colors[4];
+  Color tint = getTintColor(quad.tintIndex);
+  for (int i = 0; i < 4; ++i) {
+    vertices[i] = {quad.corners[i].x + x, quad.corners[i].y + y,
+                   quad.corners[i].z + z};
+    colors[i] =
+        shadeColor(tint, computeShade(cell, quad.face, quad.corners[i]));
+  }
+  addQuad(meshes[static_cast<int>(quad.layer)][quad.atlasHandle], vertices,
+          quad.atlasUvs, colors);
+}
+
+void ChunkMesher::generateBlockMesh(const Block &block, int x, int y, int z) {
+  const BakedModel &model = block.bakedModel;
+  bool greedy = snapshot.mode == MeshingMode::Greedy;
+  int cell = SectionSnapshot::cellIndex(x, y, z);
+
+  for (const BakedQuad &quad : model.getQuads()) {
+    // Full faces are merged by generateGreedyMesh instead
+    if (greedy && model.isFullFace(quad.face)) {
+      continue;
+    }
+
+    // Skip face if it should be culled based on the cullface property
+    if (quad.cullface != Direction::None && isFaceCulled(cell, quad.cullface)) {
+      continue;
+    }
+
+    addBlockQuad(quad, x, y, z);
+  }
+}
+
+void ChunkMesher::generateGreedyMesh() {
+  const int size = ChunkSection::SIZE;
+  uint32_t mask[ChunkSection::SIZE * ChunkSection::SIZE];
+
+  for (int f = 0; f < 6; ++f) {
+    Direction face = static_cast<Direction>(f);
+
+    // Sweep slices along the face normal n, merging within the (u, v) plane
+    int n = getAxis(face);
+    int u = (n + 1) % 3;
+    int v = (n + 2) % 3;
+
+    for (int slice = 0; slice < size; ++slice) {
+      // Mark visible full faces in this slice with their palette index and
+      // shade. Faces whose corners are shaded differently can't be
+      // stretched, so they are added on their own straight away.
+      for (int j = 0; j < size; ++j) {
+        for (int i = 0; i < size; ++i) {
+          int pos[3];
+          pos[n] = slice;
+          pos[u] = i;
+          pos[v] = j;
+          int cell = SectionSnapshot::cellIndex(pos[0], pos[1], pos[2]);
+          uint16_t index = snapshot.cells[cell];
+          mask[j * size + i] = 0;
+          if (index == 0 ||
+              !paletteBlocks[index]->bakedModel.isFullFace(face) ||
+              isFaceCulled(cell, face)) {
+            continue;
+          }
+
+          const BakedModel &model = paletteBlocks[index]->bakedModel;
+          bool uniform = true;
+          uint8_t shade = 0;
+          for (const BakedQuad &quad : model.getQuads()) {
+            if (quad.face != face) {
+              continue;
+            }
+            shade = computeShade(cell, face, quad.corners[0]);
+            for (int c = 1; c < 4 && uniform; ++c) {
+              uniform = computeShade(cell, face, quad.corners[c]) == shade;
+            }
+            break;
+          }
+          if (uniform) {
+            mask[j * size + i] = index | static_cast<uint32_t>(shade) << 16;
+            continue;
+          }
+          for (const BakedQuad &quad : model.getQuads()) {
+            if (quad.face == face) {
+              addBlockQuad(quad, pos[0], pos[1], pos[2]);
+            }
+          }
+        }
+      }
+
+      // Grow each unmerged face into the widest, then tallest, rectangle of
+      // equally shaded faces from the same block
+      for (int j = 0; j < size; ++j) {
+        for (int i = 0; i < size;) {
+          uint32_t key = mask[j * size + i];
+          if (key == 0) {
+            ++i;
+            continue;
+          }
+          uint16_t index = key & 0xFFFF;
+          uint8_t shade = key >> 16;
+
+          int w = 1;
+          while (i + w < size && mask[j * size + i + w] == key) {
+            ++w;
+          }
+          int h = 1;
+          for (; j + h < size; ++h) {
+            bool rowMatches = true;
+            for (int k = 0; k < w && rowMatches; ++k) {
+              rowMatches = mask[(j + h) * size + i + k] == key;
+            }
+            if (!rowMatches) {
+              break;
+            }
+          }
+          for (int l = 0; l < h; ++l) {
+            for (int k = 0; k < w; ++k) {
+              mask[(j + l) * size + i + k] = 0;
+            }
+          }
+          float origin[3];
+          origin[n] = static_cast<float>(slice);
+          origin[u] = static_cast<float>(i);
+          origin[v] = static_cast<float>(j);
+
+          for (const BakedQuad &quad :
+               paletteBlocks[index]->bakedModel.getQuads()) {
+            if (quad.face != face) {
+              continue;
+            }
+
+            // Full faces map UVs affinely over the unit square, so find the
+            // UV at its (0, 0) corner and the steps along u and v, then
+            // stretch both the corners and the UVs over the rectangle.
+            Vector2 uvBase = {0, 0}, uvStepU = {0, 0}, uvStepV = {0, 0};
+            for (int c = 0; c < 4; ++c) {
+              float cu = getComponent(quad.corners[c], u);
+              float cv = getComponent(quad.corners[c], v);
+              if (cu == 0.0f && cv == 0.0f) {
+                uvBase = quad.uvs[c];
+              }
+            }
+            for (int c = 0; c < 4; ++c) {
+              float cu = getComponent(quad.corners[c], u);
+              float cv = getComponent(quad.corners[c], v);
+              if (cu == 1.0f && cv == 0.0f) {
+                uvStepU = {quad.uvs[c].x - uvBase.x, quad.uvs[c].y - uvBase.y};
+              } else if (cu == 0.0f && cv == 1.0f) {
+                uvStepV = {quad.uvs[c].x - uvBase.x, quad.uvs[c].y - uvBase.y};
+              }
+            }
+
+            Vector3 vertices[4];
+            Vector2 uvs[4];
+            for (int c = 0; c < 4; ++c) {
+              float su = getComponent(quad.corners[c], u) * w;
+              float sv = getComponent(quad.corners[c], v) * h;
+              float position[3];
+              position[n] = origin[n] + getComponent(quad.corners[c], n);
+              position[u] = origin[u] + su;
+              position[v] = origin[v] + sv;
+              vertices[c] = {position[0], position[1], position[2]};
+              uvs[c] = {uvBase.x + uvStepU.x * su + uvStepV.x * sv,
+                        uvBase.y + uvStepU.y * su + uvStepV.y * sv};
+            }
+
+            // The source texture repeats across the merged quad
+            Color color = shadeColor(getTintColor(quad.tintIndex), shade);
+            const Color colors[4] = {color, color, color, color};
+            addQuad(meshes[static_cast<int>(quad.layer)][quad.textureHandle],
+                    vertices, uvs, colors);
+          }
+
+          i += w;
+        }
+      }
+    }
+  }
+}
+
+SectionVisibility ChunkMesher::computeVisibility(
+    const SectionSnapshot &snapshot) {
+  // Enclosed sections are only ever made of opaque blocks
+  if (snapshot.enclosed) {
+    return SectionVisibility::none();
+  }
+
+  const int size = ChunkSection::SIZE;
+  std::vector<bool> opaque(snapshot.palette.size(), false);
+  for (std::size_t i = 1; i < opaque.size(); ++i) {
+    opaque[i] =
+        BlockRegistry::getBlock(snapshot.palette[i].block).bakedModel.isOpaque();
+  }
+
+  // Opaque blocks are marked visited up front, so the fill never enters them
+  std::vector<bool> visited(ChunkSection::VOLUME);
+  int openCount = 0;
+  for (int y = 0; y < size; ++y) {
+    for (int z = 0; z < size; ++z) {
+      for (int x = 0; x < size; ++x) {
+        bool blocked = opaque[snapshot.cells[SectionSnapshot::cellIndex(x, y, z)]];
+        visited[ChunkSection::blockIndex(x, y, z)] = blocked;
+        openCount += !blocked;
+      }
+    }
+  }
+
+  // Nothing to flood fill, or too little to block anything
+  if (openCount == 0) {
+    return SectionVisibility::none();
+  }
+  if (openCount == ChunkSection::VOLUME) {
+    return SectionVisibility::all();
+  }
+
+  SectionVisibility visibility = SectionVisibility::none();
+  std::vector<uint16_t> stack;
+  stack.reserve(ChunkSection::VOLUME);
+
+  // Only blocks on the section boundary can start a region touching a face
+  for (int start = 0; start < ChunkSection::VOLUME; ++start) {
+    int sx = start % size;
+    int sz = start / size % size;
+    int sy = start / (size * size);
+    bool onBoundary = sx == 0 || sx == size - 1 || sy == 0 || sy == size - 1 ||
+                      sz == 0 || sz == size - 1;
+    if (!onBoundary || visited[start]) {
+      continue;
+    }
+
+    // Faces touched by this connected region of open blocks
+    uint8_t faces = 0;
+    visited[start] = true;
+    stack.push_back(static_cast<uint16_t>(start));
+    while (!stack.empty()) {
+      int index = stack.back();
+      stack.pop_back();
+      int x = index % size;
+      int z = index / size % size;
+      int y = index / (size * size);
+
+      for (int face = 0; face < 6; ++face) {
+        DirectionOffset offset = getOffset(static_cast<Direction>(face));
+        int nx = x + offset.x;
+        int ny = y + offset.y;
+        int nz = z + offset.z;
+        if (nx < 0 || nx >= size || ny < 0 || ny >= size || nz < 0 ||
+            nz >= size) {
+          faces |= 1 << face;
+          continue;
+        }
+        int neighbor = static_cast<int>(ChunkSection::blockIndex(nx, ny, nz));
+        if (!visited[neighbor]) {
+          visited[neighbor] = true;
+          stack.push_back(static_cast<uint16_t>(neighbor));
+        }
+      }
+    }
+
+    for (int a = 0; a < 6; ++a) {
+      for (int b = a; b < 6; ++b) {
+        if ((faces >> a & 1) && (faces >> b & 1)) {
+          visibility.connect(static_cast<Direction>(a),
+                             static_cast<Direction>(b));
+        }
+      }
+    }
+  }
+  return visibility;
+}
+
+} // namespace MCPSP
@@ -0,0 +1,99 @@
+#include "chunk_section.hpp"
+#include "block_registry.hpp"
+#include <stdexcept>
+#include <utility>
+
+namespace MCPSP {
+
+bool ChunkSection::setBlock(int x, int y, int z, const BlockState &state) {
+  std::size_t index = blockIndex(x, y, z);
+  const BlockState old = blocks.get(index);
+  if (old == state) {
+    return false;
+  }
+
+  if (old.block.getId() != ResourceLocation::AIR_ID) {
+    --nonAirCount;
+    if (BlockRegistry::getBlock(old.block).bakedModel.isCullable()) {
+      --cullableCount;
+    }
+  }
+  if (state.block.getId() != ResourceLocation::AIR_ID) {
+    ++nonAirCount;
+    if (BlockRegistry::getBlock(state.block).bakedModel.isCullable()) {
+      ++cullableCount;
+    }
+  }
+
+  blocks.set(index, state);
+  dirty = true;
+  return true;
+}
+
+void ChunkSection::setMeshes(MeshSet &&replacement) {
+  for (const LayerMeshes &layer : replacement) {
+    for (const auto &[texture, mesh] : layer) {
+      TextureManager::acquire(texture);
+    }
+  }
+  for (const LayerMeshes &layer : meshes) {
+    for (const auto &[texture, mesh] : layer) {
+      TextureManager::release(texture);
+    }
+  }
+  meshes = std::move(replacement);
+}
+
+void ChunkSection::write(ByteWriter &out) const {
+  const std::vector<BlockState> &palette = blocks.getPalette();
+  out.u16(static_cast<uint16_t>(palette.size()));
+  for (const BlockState &state : palette) {
+    out.string(state.block);
+  }
+
+  // Terrain is mostly long stretches of the same block, so runs are far
+  // smaller than the packed indices
+  std::vector<std::pair<uint16_t, uint16_t>> runs;
+  for (std::size_t i = 0; i < VOLUME; ++i) {
+    uint16_t index = static_cast<uint16_t>(blocks.getIndex(i));
+    if (!runs.empty() && runs.back().second == index) {
+      ++runs.back().first;
+    } else {
+      runs.push_back({1, index});
+    }
+  }
+  out.u16(static_cast<uint16_t>(runs.size()));
+  for (const auto &[length, index] : runs) {
+    out.u16(length);
+    out.u16(index);
+  }
+}
+
+void ChunkSection::read(ByteReader &in) {
+  std::vector<BlockState> palette(in.u16());
+  for (BlockState &state : palette) {
+    state.block = ResourceLocation(in.string());
+  }
+
+  std::size_t index = 0;
+  for (uint16_t runCount = in.u16(); runCount > 0; --runCount) {
+    uint16_t length = in.u16();
+    uint16_t paletteIndex = in.u16();
+    if (paletteIndex >= palette.size() || index + length > VOLUME) {
+      throw std::runtime_error("malformed section data");
+    }
+    // Sections start out as air, so air runs can be skipped
+    if (palette[paletteIndex].block.getId() != ResourceLocation::AIR_ID) {
+      for (std::size_t i = index; i < index + length; ++i) {
+        setBlock(i % SIZE, i / (SIZE * SIZE), i / SIZE % SIZE,
+                 palette[paletteIndex]);
+      }
+    }
+    index += length;
+  }
+  if (index != VOLUME) {
+    throw std::runtime_error("malformed section data");
+  }
+}
+
+} // namespace MCPSP
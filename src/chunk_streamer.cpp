@@ -0,0 +1,102 @@
+#include "chunk_streamer.hpp"
+#include "world.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace MCPSP {
+
+static int getDistance(const ChunkPosition &a, const ChunkPosition &b) {
+  int dx = a.x - b.x;
+  int dz = a.z - b.z;
+  return dx * dx + dz * dz;
+}
+
+void ChunkStreamer::queueRequests() {
+  requests = {};
+  for (int dz = -loadRadius; dz <= loadRadius; ++dz) {
+    for (int dx = -loadRadius; dx <= loadRadius; ++dx) {
+      ChunkPosition position{center.x + dx, center.z + dz};
+      int distance = getDistance(position, center);
+      if (distance <= loadRadius * loadRadius &&
+          !world.hasChunk(position.x, position.z)) {
+        requests.push({distance, position});
+      }
+    }
+  }
+}
+
+void ChunkStreamer::evict() {
+  std::vector<Request> candidates;
+  for (auto it = lastUsed.begin(); it != lastUsed.end();) {
+    int distance = getDistance(it->first, center);
+    if (distance > unloadRadius * unloadRadius) {
+      world.unloadChunk(it->first.x, it->first.z);
+      it = lastUsed.erase(it);
+      continue;
+    }
+    if (distance > loadRadius * loadRadius) {
+      candidates.push_back({distance, it->first});
+    }
+    ++it;
+  }
+
+  if (world.getMemoryUsage() <= memoryBudget) {
+    return;
+  }
+
+  // Least recently used first, furthest first among equally old chunks
+  std::sort(candidates.begin(), candidates.end(),
+            [this](const Request &a, const Request &b) {
+              uint32_t usedA = lastUsed[a.position];
+              uint32_t usedB = lastUsed[b.position];
+              if (usedA != usedB) {
+                return usedA < usedB;
+              }
+              return a.distance > b.distance;
+            });
+  for (const Request &candidate : candidates) {
+    if (world.getMemoryUsage() <= memoryBudget) {
+      break;
+    }
+    world.unloadChunk(candidate.position.x, candidate.position.z);
+    lastUsed.erase(candidate.position);
+  }
+}
+
+void ChunkStreamer::update(const Vector3 &camera) {
+  ++updateCount;
+
+  ChunkPosition cameraChunk{static_cast<int>(std::floor(camera.x / 16.0f)),
+                            static_cast<int>(std::floor(camera.z / 16.0f))};
+  if (!hasCenter || !(cameraChunk == center)) {
+    center = cameraChunk;
+    hasCenter = true;
+    queueRequests();
+  }
+
+  for (auto &[position, used] : lastUsed) {
+    if (getDistance(position, center) <= loadRadius * loadRadius) {
+      used = updateCount;
+    }
+  }
+
+  evict();
+
+  // Loading stops while over budget, rather than evicting chunks that would
+  // only be requested again
+  for (int generated = 0; generated < generateBudget && !requests.empty() &&
+                          world.getMemoryUsage() <= memoryBudget;) {
+    ChunkPosition position = requests.top().position;
+    requests.pop();
+    if (world.hasChunk(position.x, position.z)) {
+      continue;
+    }
+    if (!world.loadChunk(position.x, position.z)) {
+      world.generateChunk(position.x, position.z);
+    }
+    lastUsed[position] = updateCount;
+    ++generated;
+  }
+}
+
+} // namespace MCPSP
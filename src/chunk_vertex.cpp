@@ -0,0 +1,21 @@
+#include "chunk_vertex.hpp"
+#include <vector>
+
+namespace MCPSP {
+
+const uint16_t *getQuadIndices() {
+  static const std::vector<uint16_t> indices = [] {
+    static const uint16_t order[] = {0, 1, 2, 0, 2, 3};
+    std::vector<uint16_t> result;
+    result.reserve(QUAD_BATCH_SIZE * 6);
+    for (std::size_t quad = 0; quad < QUAD_BATCH_SIZE; ++quad) {
+      for (uint16_t i : order) {
+        result.push_back(static_cast<uint16_t>(quad * 4 + i));
+      }
+    }
+    return result;
+  }();
+  return indices.data();
+}
+
+} // namespace MCPSP
@@ -0,0 +1,47 @@
+#include "frustum.hpp"
+#include "raymath.h"
+#include "rlgl.h"
+#include <cmath>
+
+namespace MCPSP {
+
+Frustum::Frustum(const Camera3D &camera, float aspect) {
+  Matrix view = MatrixLookAt(camera.position, camera.target, camera.up);
+  Matrix projection =
+      MatrixPerspective(camera.fovy * DEG2RAD, aspect, RL_CULL_DISTANCE_NEAR,
+                        RL_CULL_DISTANCE_FAR);
+  Matrix m = MatrixMultiply(view, projection);
+
+  // Each plane is the last row of the clip matrix plus or minus one of the
+  // others (Gribb & Hartmann)
+  planes[0] = {m.m3 + m.m0, m.m7 + m.m4, m.m11 + m.m8, m.m15 + m.m12};  // Left
+  planes[1] = {m.m3 - m.m0, m.m7 - m.m4, m.m11 - m.m8, m.m15 - m.m12};  // Right
+  planes[2] = {m.m3 + m.m1, m.m7 + m.m5, m.m11 + m.m9, m.m15 + m.m13};  // Bottom
+  planes[3] = {m.m3 - m.m1, m.m7 - m.m5, m.m11 - m.m9, m.m15 - m.m13};  // Top
+  planes[4] = {m.m3 + m.m2, m.m7 + m.m6, m.m11 + m.m10, m.m15 + m.m14}; // Near
+  planes[5] = {m.m3 - m.m2, m.m7 - m.m6, m.m11 - m.m10, m.m15 - m.m14}; // Far
+
+  for (Vector4 &plane : planes) {
+    float length = std::sqrt(plane.x * plane.x + plane.y * plane.y +
+                             plane.z * plane.z);
+    if (length > 0.0f) {
+      plane = {plane.x / length, plane.y / length, plane.z / length,
+               plane.w / length};
+    }
+  }
+}
+
+bool Frustum::isBoxVisible(const Vector3 &min, const Vector3 &max) const {
+  for (const Vector4 &plane : planes) {
+    // Only the corner furthest along the plane normal needs testing
+    float x = plane.x >= 0.0f ? max.x : min.x;
+    float y = plane.y >= 0.0f ? max.y : min.y;
+    float z = plane.z >= 0.0f ? max.z : min.z;
+    if (plane.x * x + plane.y * y + plane.z * z + plane.w < 0.0f) {
+      return false;
+    }
+  }
+  return true;
+}
+
+} // namespace MCPSP
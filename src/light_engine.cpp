@@ -0,0 +1,337 @@
+#include "light_engine.hpp"
+#include "block_registry.hpp"
+#include "chunk.hpp"
+#include "direction.hpp"
+#include "world.hpp"
+#include <algorithm>
+#include <chrono>
+
+namespace MCPSP {
+
+namespace {
+
+// Takes chunk-local coordinates
+bool isOpaque(const Chunk &chunk, int x, int y, int z) {
+  return BlockRegistry::getBlock(chunk.getBlock(x, y, z).block)
+      .bakedModel.isOpaque();
+}
+
+bool isOpaque(const BlockState &state) {
+  return BlockRegistry::getBlock(state.block).bakedModel.isOpaque();
+}
+
+} // namespace
+
+Chunk *LightEngine::getChunk(int chunkX, int chunkZ) {
+  if (cachedChunk == nullptr || cachedX != chunkX || cachedZ != chunkZ) {
+    cachedChunk = world.getChunk(chunkX, chunkZ);
+    if (cachedChunk == unloading) {
+      cachedChunk = nullptr;
+    }
+    cachedX = chunkX;
+    cachedZ = chunkZ;
+  }
+  return cachedChunk;
+}
+
+void LightEngine::setLight(Chunk &chunk, LightChannel channel, int x, int y,
+                           int z, uint8_t level) {
+  chunk.setLight(channel, x & 15, y, z & 15, level);
+  if (&chunk != initializing) {
+    chunk.markBlockDirty(x & 15, y, z & 15);
+  }
+}
+
+void LightEngine::propagate(LightChannel channel) {
+  for (std::size_t head = 0; head < propagation.size(); ++head) {
+    Node node = propagation[head];
+    for (int face = 0; face < 6; ++face) {
+      Direction direction = static_cast<Direction>(face);
+      DirectionOffset offset = getOffset(direction);
+      int x = node.x + offset.x;
+      int y = node.y + offset.y;
+      int z = node.z + offset.z;
+      if (y < 0 || y >= Chunk::HEIGHT) {
+        continue;
+      }
+
+      uint8_t level = channel == LightChannel::Sky &&
+                              direction == Direction::Down && node.level == 15
+                          ? 15
+                          : node.level - 1;
+      if (level == 0) {
+        continue;
+      }
+      Chunk *chunk = getChunk(x >> 4, z >> 4);
+      if (chunk == nullptr ||
+          chunk->getLight(channel, x & 15, y, z & 15) >= level ||
+          isOpaque(*chunk, x & 15, y, z & 15)) {
+        continue;
+      }
+      setLight(*chunk, channel, x, y, z, level);
+      propagation.push_back({x, y, z, level});
+    }
+  }
+  propagation.clear();
+}
+
+void LightEngine::removeLight(LightChannel channel) {
+  for (std::size_t head = 0; head < removal.size(); ++head) {
+    Node node = removal[head];
+    for (int face = 0; face < 6; ++face) {
+      Direction direction = static_cast<Direction>(face);
+      DirectionOffset offset = getOffset(direction);
+      int x = node.x + offset.x;
+      int y = node.y + offset.y;
+      int z = node.z + offset.z;
+      if (y < 0 || y >= Chunk::HEIGHT) {
+        continue;
+      }
+      Chunk *chunk = getChunk(x >> 4, z >> 4);
+      if (chunk == nullptr) {
+        continue;
+      }
+
+      uint8_t level = chunk->getLight(channel, x & 15, y, z & 15);
+      if (level == 0) {
+        continue;
+      }
+      // Dimmer light may have come from the removed node; brighter or equal
+      // light came from elsewhere and has to refill the cleared blocks
+      bool dependent =
+          level < node.level ||
+          (channel == LightChannel::Sky && direction == Direction::Down &&
+           node.level == 15);
+      if (dependent) {
+        // Emitting blocks keep their own light, which spreads out again once
+        // the light they had from the removed node is gone
+        uint8_t emission =
+            channel == LightChannel::Block
+                ? BlockRegistry::getBlock(
+                      chunk->getBlock(x & 15, y, z & 15).block)
+                      .lightEmission
+                : 0;
+        setLight(*chunk, channel, x, y, z, emission);
+        removal.push_back({x, y, z, level});
+        if (emission > 0) {
+          propagation.push_back({x, y, z, emission});
+        }
+      } else {
+        propagation.push_back({x, y, z, level});
+      }
+    }
+  }
+  removal.clear();
+}
+
+void LightEngine::initChunk(Chunk &chunk) {
+  auto start = std::chrono::steady_clock::now();
+  cachedChunk = nullptr;
+  initializing = &chunk;
+  int baseX = chunk.getChunkX() * 16;
+  int baseZ = chunk.getChunkZ() * 16;
+
+  // Sky light reaches undimmed down to the first opaque block of each column
+  int heights[256];
+  int maxHeight = 0;
+  for (int z = 0; z < 16; ++z) {
+    for (int x = 0; x < 16; ++x) {
+      int y = Chunk::HEIGHT - 1;
+      while (y >= 0 && !isOpaque(chunk, x, y, z)) {
+        --y;
+      }
+      heights[z * 16 + x] = y + 1;
+      maxHeight = std::max(maxHeight, y + 1);
+    }
+  }
+
+  // Sections above every column are lit without storing any light
+  int litFrom = Chunk::HEIGHT;
+  for (int sectionY = 0; sectionY < Chunk::SECTION_COUNT; ++sectionY) {
+    bool open = sectionY * ChunkSection::SIZE >= maxHeight;
+    chunk.resetLight(LightChannel::Sky, sectionY, open ? 15 : 0);
+    chunk.resetLight(LightChannel::Block, sectionY, 0);
+    if (open && litFrom == Chunk::HEIGHT) {
+      litFrom = sectionY * ChunkSection::SIZE;
+    }
+  }
+  for (int z = 0; z < 16; ++z) {
+    for (int x = 0; x < 16; ++x) {
+      for (int y = heights[z * 16 + x]; y < litFrom; ++y) {
+        chunk.setLight(LightChannel::Sky, x, y, z, 15);
+      }
+    }
+  }
+
+  // Sky light spreads sideways only where a neighbouring column is taller.
+  // Border columns can't know the height across the border, so all of their
+  // sky lit blocks are spread.
+  for (int z = 0; z < 16; ++z) {
+    for (int x = 0; x < 16; ++x) {
+      int top = Chunk::HEIGHT;
+      if (x > 0 && x < 15 && z > 0 && z < 15) {
+        top = std::max({heights[z * 16 + x - 1], heights[z * 16 + x + 1],
+                        heights[(z - 1) * 16 + x], heights[(z + 1) * 16 + x]});
+      }
+      for (int y = heights[z * 16 + x]; y < top; ++y) {
+        propagation.push_back({baseX + x, y, baseZ + z, 15});
+      }
+    }
+  }
+
+  // Light already in the neighbours flows in across the borders
+  static const int neighbors[4][2] = {{-1, 0}, {1, 0}, {0, -1}, {0, 1}};
+  auto pullFromNeighbors = [&](LightChannel channel) {
+    for (const auto &offset : neighbors) {
+      Chunk *neighbor =
+          world.getChunk(chunk.getChunkX() + offset[0],
+                         chunk.getChunkZ() + offset[1]);
+      if (neighbor == nullptr) {
+        continue;
+      }
+      for (int i = 0; i < 16; ++i) {
+        // The column of the neighbour that touches this chunk
+        int x = offset[0] != 0 ? (offset[0] < 0 ? 15 : 0) : i;
+        int z = offset[1] != 0 ? (offset[1] < 0 ? 15 : 0) : i;
+        for (int y = 0; y < Chunk::HEIGHT; ++y) {
+          uint8_t level = neighbor->getLight(channel, x, y, z);
+          if (level > 1) {
+            propagation.push_back({(chunk.getChunkX() + offset[0]) * 16 + x, y,
+                                   (chunk.getChunkZ() + offset[1]) * 16 + z,
+                                   level});
+          }
+        }
+      }
+    }
+  };
+  pullFromNeighbors(LightChannel::Sky);
+  propagate(LightChannel::Sky);
+
+  // Block light starts at emitting blocks. Sections whose palette has none
+  // are skipped without looking at their blocks.
+  for (int sectionY = 0; sectionY < Chunk::SECTION_COUNT; ++sectionY) {
+    const ChunkSection &section = chunk.getSection(sectionY);
+    bool emits = false;
+    for (const BlockState &state : section.getBlocks().getPalette()) {
+      emits = emits || BlockRegistry::getBlock(state.block).lightEmission > 0;
+    }
+    if (!emits) {
+      continue;
+    }
+    for (int i = 0; i < ChunkSection::VOLUME; ++i) {
+      uint8_t emission =
+          BlockRegistry::getBlock(section.getBlocks().get(i).block)
+              .lightEmission;
+      if (emission == 0) {
+        continue;
+      }
+      int x = i % 16;
+      int z = i / 16 % 16;
+      int y = sectionY * ChunkSection::SIZE + i / 256;
+      chunk.setLight(LightChannel::Block, x, y, z, emission);
+      propagation.push_back({baseX + x, y, baseZ + z, emission});
+    }
+  }
+  pullFromNeighbors(LightChannel::Block);
+  propagate(LightChannel::Block);
+
+  initializing = nullptr;
+  ++chunksLit;
+  initSeconds += std::chrono::duration<double>(
+                     std::chrono::steady_clock::now() - start)
+                     .count();
+}
+
+void LightEngine::unloadChunk(const Chunk &chunk) {
+  cachedChunk = nullptr;
+  unloading = &chunk;
+  int baseX = chunk.getChunkX() * 16;
+  int baseZ = chunk.getChunkZ() * 16;
+  for (LightChannel channel : {LightChannel::Sky, LightChannel::Block}) {
+    // Removing the border blocks' light clears whatever depended on it
+    // across the border, without touching the chunk itself
+    for (int z = 0; z < 16; ++z) {
+      for (int x = 0; x < 16; ++x) {
+        if (x != 0 && x != 15 && z != 0 && z != 15) {
+          continue;
+        }
+        for (int y = 0; y < Chunk::HEIGHT; ++y) {
+          uint8_t level = chunk.getLight(channel, x, y, z);
+          if (level > 0) {
+            removal.push_back({baseX + x, y, baseZ + z, level});
+          }
+        }
+      }
+    }
+    removeLight(channel);
+    propagate(channel);
+  }
+  unloading = nullptr;
+}
+
+void LightEngine::onBlockChanged(int x, int y, int z, const BlockState &old) {
+  auto start = std::chrono::steady_clock::now();
+  cachedChunk = nullptr;
+  Chunk *chunk = getChunk(x >> 4, z >> 4);
+  if (chunk == nullptr) {
+    return;
+  }
+
+  const Block &block =
+      BlockRegistry::getBlock(chunk->getBlock(x & 15, y, z & 15).block);
+  bool opaque = block.bakedModel.isOpaque();
+  // Swapping between blocks that treat light the same needs no relight
+  if (opaque == isOpaque(old) &&
+      block.lightEmission == BlockRegistry::getBlock(old.block).lightEmission) {
+    return;
+  }
+
+  for (LightChannel channel : {LightChannel::Sky, LightChannel::Block}) {
+    uint8_t previous = chunk->getLight(channel, x & 15, y, z & 15);
+    if (previous > 0) {
+      setLight(*chunk, channel, x, y, z, 0);
+      removal.push_back({x, y, z, previous});
+      removeLight(channel);
+    }
+
+    // The block itself may be a source
+    uint8_t source = block.lightEmission;
+    if (channel == LightChannel::Sky) {
+      bool underSky =
+          y == Chunk::HEIGHT - 1 ||
+          chunk->getLight(LightChannel::Sky, x & 15, y + 1, z & 15) == 15;
+      source = !opaque && underSky ? 15 : 0;
+    }
+    if (source > 0) {
+      setLight(*chunk, channel, x, y, z, source);
+      propagation.push_back({x, y, z, source});
+    }
+
+    // Light around the block can now flow into it
+    if (!opaque) {
+      for (int face = 0; face < 6; ++face) {
+        DirectionOffset offset = getOffset(static_cast<Direction>(face));
+        int nx = x + offset.x;
+        int ny = y + offset.y;
+        int nz = z + offset.z;
+        Chunk *neighbor = getChunk(nx >> 4, nz >> 4);
+        if (ny < 0 || ny >= Chunk::HEIGHT || neighbor == nullptr) {
+          continue;
+        }
+        uint8_t level = neighbor->getLight(channel, nx & 15, ny, nz & 15);
+        if (level > 1) {
+          propagation.push_back({nx, ny, nz, level});
+        }
+      }
+    }
+    propagate(channel);
+  }
+
+  ++relights;
+  lastRelightSeconds = std::chrono::duration<double>(
+                           std::chrono::steady_clock::now() - start)
+                           .count();
+  relightSeconds += lastRelightSeconds;
+}
+
+} // namespace MCPSP
@@ -1,9 +1,17 @@
 #include "block_registry.hpp"
 #include "chunk.hpp"
+#include "chunk_streamer.hpp"
 #include "model.hpp"
 #include "resource_location.hpp"
+#include "texture_manager.hpp"
 #include "world.hpp"
+#include <algorithm>
+#include <chrono>
+#include <climits>
 #include <cmath>
+#include <iostream>
+#include <malloc.h>
+#include <memory>
 #include <pspctrl.h>
 #include <pspdisplay.h>
 #include <pspkernel.h>
@@ -19,11 +27,18 @@ PSP_MODULE_INFO("GLTest", 0, 1, 1);
 PSP_MAIN_THREAD_ATTR(PSP_THREAD_ATTR_USER | PSP_THREAD_ATTR_VFPU);
 
 Camera3D camera = {
-    {32.0f, 20.0f, 32.0f}, {0.0f, 5.0f, 0.0f}, {0.0f, 1.0f, 0.0f}, 45.0f,
+    {32.0f, 52.0f, 32.0f}, {0.0f, 28.0f, 0.0f}, {0.0f, 1.0f, 0.0f}, 45.0f,
     CAMERA_PERSPECTIVE,
 };
 
 MCPSP::World world;
+MCPSP::ChunkStreamer streamer(world);
+
+// Game ticks run at a fixed rate, independent of the frame rate
+constexpr float TICK_SECONDS = 1.0f / 20.0f;
+// Ticks caught up on in one frame after a slow one; the rest are dropped
+constexpr int MAX_TICKS_PER_FRAME = 4;
+float tickTime = 0.0f;
 
 int exitCallback(int arg1, int arg2, void *common) {
   sceKernelExitGame();
@@ -89,11 +104,27 @@ void drawScene() {
   // Draw a grid
   DrawGrid(10, 1.0f);
 
-  world.draw();
+  world.draw(camera);
 
   EndMode3D();
 }
 
+void handleInput() {
+  static unsigned int previousButtons = 0;
+
+  SceCtrlData pad;
+  sceCtrlPeekBufferPositive(&pad, 1);
+  unsigned int pressed = pad.Buttons & ~previousButtons;
+  previousButtons = pad.Buttons;
+
+  if (pressed & PSP_CTRL_SELECT) {
+    world.setMeshingMode(MCPSP::Chunk::getMeshingMode() ==
+                                 MCPSP::MeshingMode::Greedy
+                             ? MCPSP::MeshingMode::Naive
+                             : MCPSP::MeshingMode::Greedy);
+  }
+}
+
 void load() {
   // models = {
   //     MCPSP::Model(
@@ -164,26 +195,144 @@ void load() {
   //         MCPSP::ResourceLocation("minecraft:block/potted_wither_rose")),
   // };
   DrawStatus("Registering blocks...", 10, 10, 20, WHITE);
-  MCPSP::BlockRegistry::registerBlock(
-      MCPSP::ResourceLocation("minecraft:bedrock"),
-      MCPSP::Block{
-          MCPSP::Model(MCPSP::ResourceLocation("minecraft:block/bedrock"))});
-
-  MCPSP::BlockRegistry::registerBlock(
-      MCPSP::ResourceLocation("minecraft:dirt"),
-      MCPSP::Block{
-          MCPSP::Model(MCPSP::ResourceLocation("minecraft:block/dirt"))});
-
-  MCPSP::BlockRegistry::registerBlock(
-      MCPSP::ResourceLocation("minecraft:grass_block"),
-      MCPSP::Block{MCPSP::Model(
-          MCPSP::ResourceLocation("minecraft:block/grass_block"))});
-
-  DrawStatus("Generating chunk...", 10, 10, 20, WHITE);
-  world.generateChunk(0, 0);
-  world.generateChunk(-1, 0);
-  world.generateChunk(0, -1);
-  world.generateChunk(-1, -1);
+  auto registerStart = std::chrono::steady_clock::now();
+
+  // Prefer blocks precompiled by tools/asset_compiler, which skips parsing
+  // JSON entirely
+  std::string bundle =
+      MCPSP::ResourceLocation::getAssetRoot() + "/blocks.bundle";
+  if (FileExists(bundle.c_str())) {
+    MCPSP::BlockRegistry::registerBundle(bundle);
+  } else {
+    MCPSP::BlockRegistry::registerBlock(
+        MCPSP::ResourceLocation("minecraft:bedrock"),
+        MCPSP::Block{
+            MCPSP::Model(MCPSP::ResourceLocation("minecraft:block/bedrock"))});
+
+    MCPSP::BlockRegistry::registerBlock(
+        MCPSP::ResourceLocation("minecraft:dirt"),
+        MCPSP::Block{
+            MCPSP::Model(MCPSP::ResourceLocation("minecraft:block/dirt"))});
+
+    MCPSP::BlockRegistry::registerBlock(
+        MCPSP::ResourceLocation("minecraft:grass_block"),
+        MCPSP::Block{MCPSP::Model(
+            MCPSP::ResourceLocation("minecraft:block/grass_block"))});
+
+    std::cout << "Models: " << MCPSP::Model::getFileOpenCount()
+              << " files read in " << MCPSP::Model::getParseSeconds() * 1000.0
+              << " ms" << std::endl;
+  }
+
+  // newlib reports the most the heap has ever had allocated in usmblks
+  std::cout << "Registered blocks from "
+            << (FileExists(bundle.c_str()) ? "bundle" : "JSON") << " in "
+            << std::chrono::duration<double, std::milli>(
+                   std::chrono::steady_clock::now() - registerStart)
+                   .count()
+            << " ms, peak heap " << mallinfo().usmblks / 1024 << " KiB"
+            << std::endl;
+
+  DrawStatus("Stitching textures...", 10, 10, 20, WHITE);
+  MCPSP::BlockRegistry::stitchTextures();
+
+  const MCPSP::TextureManager::Stats &textures =
+      MCPSP::TextureManager::getStats();
+  std::cout << "Textures: " << MCPSP::TextureManager::getResidentBytes() / 1024
+            << " KiB of VRAM (RGBA: "
+            << MCPSP::TextureManager::getResidentRgbaBytes() / 1024
+            << " KiB), " << textures.indexed << " palettized, "
+            << textures.reduced << " left as RGBA" << std::endl;
+  if (textures.converted > 0) {
+    std::cout << "Texture uploads: " << textures.converted << " converted, "
+              << textures.convertSeconds * 1000.0 / textures.converted
+              << " ms each (mipmaps "
+              << (MCPSP::TextureManager::isMipmapped() ? "on" : "off") << ")"
+              << std::endl;
+  }
+
+  DrawStatus("Generating chunks...", 10, 10, 20, WHITE);
+  world.setSaveDirectory("ms0:/PSP/SAVEDATA/MCPSP");
+  // Generate everything around the starting position up front, so the first
+  // frames don't show the world filling in
+  streamer.setGenerateBudget(INT_MAX);
+  streamer.update(camera.position);
+  streamer.setGenerateBudget(1);
+
+  const MCPSP::TerrainGenerator &generator = world.getGenerator();
+  if (generator.getChunksGenerated() > 0) {
+    std::cout << "Generated " << generator.getChunksGenerated()
+              << " chunks in " << generator.getGenerateSeconds() * 1000.0
+              << " ms, "
+              << generator.getChunksGenerated() /
+                     generator.getGenerateSeconds()
+              << " chunks/s (" << MCPSP::GradientNoise::getSimdKernelName()
+              << " noise)" << std::endl;
+  }
+
+  const MCPSP::RegionStorage &storage = world.getStorage();
+  if (storage.getChunksRead() > 0) {
+    std::cout << "Loaded " << storage.getChunksRead() << " chunks ("
+              << storage.getBytesRead() / 1024 << " KiB) in "
+              << storage.getReadSeconds() * 1000.0 << " ms, "
+              << storage.getChunksRead() / storage.getReadSeconds()
+              << " chunks/s" << std::endl;
+  }
+
+  if (const MCPSP::Chunk *chunk = world.getChunk(0, 0)) {
+    std::cout << "Chunk block storage: " << chunk->getMemoryUsage()
+              << " bytes (unpacked: "
+              << MCPSP::Chunk::getUnpackedMemoryUsage() << " bytes)"
+              << std::endl;
+  }
+
+  const MCPSP::LightEngine &light = world.getLightEngine();
+  if (light.getChunksLit() > 0) {
+    std::cout << "Lit " << light.getChunksLit() << " chunks, "
+              << light.getInitSeconds() * 1000.0 / light.getChunksLit()
+              << " ms per chunk" << std::endl;
+  }
+
+  // Time relighting by digging out a surface block and putting it back, in a
+  // throwaway world so the one being played stays untouched
+  {
+    auto scratch = std::make_unique<MCPSP::World>(generator.getSeed());
+    scratch->generateChunk(0, 0);
+    MCPSP::Chunk *chunk = scratch->getChunk(0, 0);
+    int y = MCPSP::Chunk::HEIGHT - 1;
+    while (y > 0 && chunk->isAir(8, y, 8)) {
+      --y;
+    }
+    MCPSP::BlockState surface = chunk->getBlock(8, y, 8);
+    for (int i = 0; i < 8; ++i) {
+      chunk->setBlock(8, y, 8, MCPSP::BlockState());
+      chunk->setBlock(8, y, 8, surface);
+    }
+    const MCPSP::LightEngine &scratchLight = scratch->getLightEngine();
+    if (scratchLight.getRelights() > 0) {
+      std::cout << "Relight: "
+                << scratchLight.getRelightSeconds() * 1000.0 /
+                       scratchLight.getRelights()
+                << " ms per block change" << std::endl;
+    }
+  }
+
+  // Time picking rays cast from the camera in every direction
+  const int rayCount = 4096;
+  int hits = 0;
+  auto raycastStart = std::chrono::steady_clock::now();
+  for (int i = 0; i < rayCount; ++i) {
+    float yaw = (i % 64) * (2.0f * PI / 64.0f);
+    float pitch = (i / 64) * (PI / 64.0f) - PI / 2.0f;
+    Vector3 direction = {std::cos(pitch) * std::cos(yaw), std::sin(pitch),
+                         std::cos(pitch) * std::sin(yaw)};
+    hits += world.raycast(camera.position, direction, 64.0f).hit;
+  }
+  double raycastSeconds = std::chrono::duration<double>(
+                              std::chrono::steady_clock::now() - raycastStart)
+                              .count();
+  std::cout << "Raycast: " << rayCount / raycastSeconds << " rays/s, " << hits
+            << " of " << rayCount << " hit" << std::endl;
 }
 
 int main_handled(int argc, char *argv[]) {
@@ -194,6 +343,16 @@ int main_handled(int argc, char *argv[]) {
 
   // Main game loop
   while (!WindowShouldClose()) {
+    streamer.update(camera.position);
+    tickTime += GetFrameTime();
+    for (int i = 0; i < MAX_TICKS_PER_FRAME && tickTime >= TICK_SECONDS; ++i) {
+      world.tick();
+      tickTime -= TICK_SECONDS;
+    }
+    tickTime = std::min(tickTime, TICK_SECONDS);
+    world.update(camera.position);
+    MCPSP::TextureManager::beginFrame();
+
     BeginDrawing();
     ClearBackground({75, 172, 255});
 
@@ -203,11 +362,60 @@ int main_handled(int argc, char *argv[]) {
     DrawTextf("Camera Position: (%.2f, %.2f, %.2f)", 10, 30, 20, WHITE,
               camera.position.x, camera.position.y, camera.position.z);
 
+    DrawTextf("%s meshing: %u vertices, %u KiB, %.2f ms (SELECT to toggle)",
+              10, 50, 20, WHITE,
+              MCPSP::Chunk::getMeshingMode() == MCPSP::MeshingMode::Greedy
+                  ? "Greedy"
+                  : "Naive",
+              static_cast<unsigned>(world.getVertexCount()),
+              static_cast<unsigned>(world.getVertexBytes() / 1024),
+              GetFrameTime() * 1000.0f);
+
+    const MCPSP::DrawStats &stats = world.getDrawStats();
+    DrawTextf("Chunks: %u loaded (%u KiB), %u pending", 10, 70, 20, WHITE,
+              static_cast<unsigned>(world.getChunkCount()),
+              static_cast<unsigned>(world.getMemoryUsage() / 1024),
+              static_cast<unsigned>(streamer.getPendingCount()));
+    DrawTextf("Chunks: %u drawn, %u culled. Triangles: %u drawn, %u culled",
+              10, 90, 20, WHITE, stats.chunksDrawn, stats.chunksCulled,
+              static_cast<unsigned>(stats.trianglesDrawn),
+              static_cast<unsigned>(stats.trianglesCulled));
+
+    unsigned candidates = stats.sectionsDrawn + stats.sectionsOccluded;
+    DrawTextf("Occlusion: %u of %u sections hidden (%u%%)", 10, 110, 20,
+              WHITE,
+              stats.sectionsOccluded, candidates,
+              candidates > 0 ? stats.sectionsOccluded * 100 / candidates : 0);
+
+    const MCPSP::TextureManager::Stats &textures =
+        MCPSP::TextureManager::getStats();
+    DrawTextf("Textures: %u/%u KiB (RGBA: %u KiB), %u hits, %u misses, "
+              "%u evicted",
+              10, 130, 20, WHITE,
+              static_cast<unsigned>(MCPSP::TextureManager::getResidentBytes() /
+                                    1024),
+              static_cast<unsigned>(MCPSP::TextureManager::getBudget() / 1024),
+              static_cast<unsigned>(
+                  MCPSP::TextureManager::getResidentRgbaBytes() / 1024),
+              textures.hits, textures.misses, textures.evictions);
+
+    DrawTextf("Draw calls: %u, %u texture binds, %u state changes", 10, 150,
+              20, WHITE, stats.drawCalls, stats.textureBinds,
+              stats.stateChanges);
+
+    const MCPSP::TickScheduler &ticks = world.getTickScheduler();
+    DrawTextf("Ticks: %u scheduled, %u ready, %u run", 10, 170, 20, WHITE,
+              static_cast<unsigned>(ticks.getScheduledCount()),
+              static_cast<unsigned>(ticks.getReadyCount()),
+              world.getTicksRun());
+
     UpdateCamera(&camera, CAMERA_ORBITAL);
+    handleInput();
 
     EndDrawing();
   }
 
+  world.save();
   return 0;
 }
 
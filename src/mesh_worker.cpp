@@ -0,0 +1,156 @@
+#include "mesh_worker.hpp"
+#include <utility>
+
+#ifdef __PSP__
+#include <pspthreadman.h>
+#endif
+
+namespace MCPSP {
+
+#ifdef __PSP__
+
+// Lower priority than the main thread (0x20), so meshing never preempts it
+static constexpr int WORKER_PRIORITY = 0x30;
+static constexpr int WORKER_STACK_SIZE = 0x10000;
+
+int MeshWorker::entry(SceSize args, void *argp) {
+  MeshWorker *worker = *static_cast<MeshWorker **>(argp);
+  worker->run();
+  return 0;
+}
+
+void MeshWorker::start() {
+  if (running) {
+    return;
+  }
+  lock = sceKernelCreateSema("mesh_lock", 0, 1, 1, nullptr);
+  jobSignal = sceKernelCreateSema("mesh_jobs", 0, 0, 0x7fffffff, nullptr);
+  thread = sceKernelCreateThread("mesh_worker", entry, WORKER_PRIORITY,
+                                 WORKER_STACK_SIZE, PSP_THREAD_ATTR_USER,
+                                 nullptr);
+  running = true;
+
+  // The kernel copies the arguments onto the new thread's stack
+  MeshWorker *self = this;
+  sceKernelStartThread(thread, sizeof(self), &self);
+}
+
+void MeshWorker::stop() {
+  if (!running) {
+    return;
+  }
+  sceKernelWaitSema(lock, 1, nullptr);
+  running = false;
+  sceKernelSignalSema(lock, 1);
+  sceKernelSignalSema(jobSignal, 1);
+
+  sceKernelWaitThreadEnd(thread, nullptr);
+  sceKernelDeleteThread(thread);
+  sceKernelDeleteSema(jobSignal);
+  sceKernelDeleteSema(lock);
+}
+
+void MeshWorker::run() {
+  while (true) {
+    sceKernelWaitSema(jobSignal, 1, nullptr);
+
+    sceKernelWaitSema(lock, 1, nullptr);
+    if (!running) {
+      sceKernelSignalSema(lock, 1);
+      return;
+    }
+    MeshJob job = std::move(jobs.front());
+    jobs.pop_front();
+    sceKernelSignalSema(lock, 1);
+
+    MeshResult result{job.position, job.sectionY, job.ticket,
+                      ChunkMesher::generate(job.snapshot),
+                      ChunkMesher::computeVisibility(job.snapshot)};
+
+    sceKernelWaitSema(lock, 1, nullptr);
+    results.push_back(std::move(result));
+    sceKernelSignalSema(lock, 1);
+  }
+}
+
+void MeshWorker::submit(MeshJob job) {
+  sceKernelWaitSema(lock, 1, nullptr);
+  jobs.push_back(std::move(job));
+  sceKernelSignalSema(lock, 1);
+  sceKernelSignalSema(jobSignal, 1);
+}
+
+bool MeshWorker::poll(MeshResult &result) {
+  sceKernelWaitSema(lock, 1, nullptr);
+  bool found = !results.empty();
+  if (found) {
+    result = std::move(results.front());
+    results.pop_front();
+  }
+  sceKernelSignalSema(lock, 1);
+  return found;
+}
+
+#else
+
+void MeshWorker::start() {
+  if (running) {
+    return;
+  }
+  running = true;
+  thread = std::thread(&MeshWorker::run, this);
+}
+
+void MeshWorker::stop() {
+  if (!running) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> guard(mutex);
+    running = false;
+  }
+  jobSignal.notify_all();
+  thread.join();
+}
+
+void MeshWorker::run() {
+  std::unique_lock<std::mutex> guard(mutex);
+  while (true) {
+    jobSignal.wait(guard, [this] { return !running || !jobs.empty(); });
+    if (!running) {
+      return;
+    }
+    MeshJob job = std::move(jobs.front());
+    jobs.pop_front();
+
+    guard.unlock();
+    MeshResult result{job.position, job.sectionY, job.ticket,
+                      ChunkMesher::generate(job.snapshot),
+                      ChunkMesher::computeVisibility(job.snapshot)};
+    guard.lock();
+
+    results.push_back(std::move(result));
+  }
+}
+
+void MeshWorker::submit(MeshJob job) {
+  {
+    std::lock_guard<std::mutex> guard(mutex);
+    jobs.push_back(std::move(job));
+  }
+  jobSignal.notify_one();
+}
+
+bool MeshWorker::poll(MeshResult &result) {
+  std::lock_guard<std::mutex> guard(mutex);
+  if (results.empty()) {
+    return false;
+  }
+  result = std::move(results.front());
+  results.pop_front();
+  return true;
+}
+
+#endif
+
+} // namespace MCPSP
@@ -1,146 +1,452 @@
 #include "model.hpp"
 #include "raylib.h"
 #include "resource_location.hpp"
-#include "texture_manager.hpp"
-#include <GL/gl.h>
+#include <chrono>
 #include <fstream>
 #include <iostream>
 #include <nlohmann/json.hpp>
-#include <raymath.h>
-#include <rlgl.h>
+#include <stdexcept>
 
 namespace MCPSP {
 
-Model::Model(const MCPSP::ResourceLocation &location) { loadModel(location); }
+std::unordered_map<ResourceLocation, std::shared_ptr<const Model>>
+    Model::cache;
+std::size_t Model::fileOpenCount = 0;
+double Model::parseSeconds = 0.0;
+
+Model::Model(const MCPSP::ResourceLocation &location) { *this = *get(location); }
+
+std::shared_ptr<const Model> Model::get(const ResourceLocation &location) {
+  auto it = cache.find(location);
+  if (it != cache.end()) {
+    return it->second;
+  }
+
+  auto model = std::make_shared<Model>();
+  model->loadModel(location);
+  cache[location] = model;
+  return model;
+}
+
+const std::vector<ModelElement> &Model::getElements() const {
+  static const std::vector<ModelElement> none;
+  return elements ? *elements : none;
+}
+
+namespace {
+
+// Fills a model straight from the parser's token stream, so no JSON DOM is
+// ever built. Keys the model format doesn't use (display, shade, ...) are
+// skipped along with everything nested in them.
+class ModelReader : public nlohmann::json_sax<nlohmann::json> {
+  // What a JSON value means, given where it appears
+  enum class Kind {
+    Root,
+    Parent,
+    Textures,
+    Texture,
+    Elements,
+    Element,
+    From,
+    To,
+    Rotation,
+    Origin,
+    Axis,
+    Angle,
+    Faces,
+    Face,
+    Uv,
+    FaceTexture,
+    Cullface,
+    FaceRotation,
+    TintIndex,
+    Skip,
+  };
+
+  struct Frame {
+    Kind kind;
+    int index = 0; // Position within arrays
+  };
+
+  std::vector<Frame> stack;
+  // Kind of the value following the last key, and the last key outside of
+  // faces (so within a face it is still the face's direction)
+  Kind next = Kind::Root;
+  std::string lastKey;
+
+  ModelElement element;
+  ModelFace face;
+  bool faceHasUv = false;
+  // Faces of the current element that need UVs generated from its bounds
+  std::vector<std::string> facesWithoutUv;
+
+  Kind getValueKind() const {
+    if (stack.empty()) {
+      return Kind::Root;
+    }
+    switch (stack.back().kind) {
+    case Kind::Elements:
+      return Kind::Element;
+    case Kind::From:
+    case Kind::To:
+    case Kind::Origin:
+    case Kind::Uv:
+      return stack.back().kind;
+    default:
+      return next;
+    }
+  }
+
+  void endValue() {
+    if (!stack.empty()) {
+      ++stack.back().index;
+    }
+  }
+
+  void onNumber(float value) {
+    Frame *frame = stack.empty() ? nullptr : &stack.back();
+    switch (getValueKind()) {
+    case Kind::From:
+      setComponent(element.from, frame->index, value);
+      break;
+    case Kind::To:
+      setComponent(element.to, frame->index, value);
+      break;
+    case Kind::Origin:
+      setComponent(element.rotation.origin, frame->index, value);
+      break;
+    case Kind::Uv:
+      if (frame->index < 2) {
+        (frame->index == 0 ? face.uv1.x : face.uv1.y) = value;
+      } else if (frame->index < 4) {
+        (frame->index == 2 ? face.uv2.x : face.uv2.y) = value;
+      }
+      break;
+    case Kind::Angle:
+      element.rotation.angle = value;
+      break;
+    case Kind::FaceRotation:
+      face.rotation = static_cast<int>(value);
+      break;
+    case Kind::TintIndex:
+      face.tintindex = static_cast<int>(value);
+      break;
+    default:
+      break;
+    }
+    endValue();
+  }
+
+  static void setComponent(Vector3 &vector, int index, float value) {
+    if (index == 0) {
+      vector.x = value;
+    } else if (index == 1) {
+      vector.y = value;
+    } else if (index == 2) {
+      vector.z = value;
+    }
+  }
+
+  void endFace() {
+    if (faceHasUv) {
+      face.uv1.x /= 16.0f;
+      face.uv1.y /= 16.0f;
+      face.uv2.x /= 16.0f;
+      face.uv2.y /= 16.0f;
+    } else {
+      facesWithoutUv.push_back(lastKey);
+    }
+    element.faces[lastKey] = face;
+  }
+
+  void endElement() {
+    element.from.x /= 16.0f;
+    element.from.y /= 16.0f;
+    element.from.z /= 16.0f;
+    element.to.x /= 16.0f;
+    element.to.y /= 16.0f;
+    element.to.z /= 16.0f;
+    element.rotation.origin.x /= 16.0f;
+    element.rotation.origin.y /= 16.0f;
+    element.rotation.origin.z /= 16.0f;
+
+    for (const std::string &direction : facesWithoutUv) {
+      ModelFace &modelFace = element.faces[direction];
+      modelFace.uv1 = {0.0f, 0.0f};
+      modelFace.uv2 = {0.0f, 0.0f};
+
+      // Generate UVs based on model coordinates
+      // Note: from/to are already normalized to 0-1 range (divided by 16)
+      if (direction == "north") {
+        modelFace.uv1 = {element.to.x, 1.0f - element.to.y}; // Top-right
+        modelFace.uv2 = {element.from.x,
+                         1.0f - element.from.y}; // Bottom-left
+      } else if (direction == "south") {
+        modelFace.uv1 = {element.from.x, 1.0f - element.to.y}; // Top-left
+        modelFace.uv2 = {element.to.x, 1.0f - element.from.y}; // Bottom-right
+      } else if (direction == "west") {
+        modelFace.uv1 = {element.to.z, 1.0f - element.to.y}; // Top-right
+        modelFace.uv2 = {element.from.z,
+                         1.0f - element.from.y}; // Bottom-left
+      } else if (direction == "east") {
+        modelFace.uv1 = {element.from.z, 1.0f - element.to.y}; // Top-left
+        modelFace.uv2 = {element.to.z, 1.0f - element.from.y}; // Bottom-right
+      } else if (direction == "up") {
+        modelFace.uv1 = {element.from.x, element.from.z}; // Top-left
+        modelFace.uv2 = {element.to.x, element.to.z};     // Bottom-right
+      } else if (direction == "down") {
+        modelFace.uv1 = {element.from.x, element.to.z}; // Top-left
+        modelFace.uv2 = {element.to.x, element.from.z}; // Bottom-right
+      }
+    }
+    for (auto &[direction, modelFace] : element.faces) {
+      std::swap(modelFace.uv1.x, modelFace.uv2.x);
+    }
+
+    elements.push_back(std::move(element));
+  }
+
+public:
+  std::string parent;
+  std::unordered_map<std::string, std::string> textures;
+  std::vector<ModelElement> elements;
+  bool hasElements = false;
+
+  bool null() override {
+    endValue();
+    return true;
+  }
+
+  bool boolean(bool) override {
+    endValue();
+    return true;
+  }
+
+  bool number_integer(number_integer_t value) override {
+    onNumber(static_cast<float>(value));
+    return true;
+  }
+
+  bool number_unsigned(number_unsigned_t value) override {
+    onNumber(static_cast<float>(value));
+    return true;
+  }
+
+  bool number_float(number_float_t value, const string_t &) override {
+    onNumber(static_cast<float>(value));
+    return true;
+  }
+
+  bool string(string_t &value) override {
+    switch (getValueKind()) {
+    case Kind::Parent:
+      parent = std::move(value);
+      break;
+    case Kind::Texture:
+      textures[lastKey] = std::move(value);
+      break;
+    case Kind::Axis:
+      element.rotation.axis = std::move(value);
+      break;
+    case Kind::FaceTexture:
+      face.texture = std::move(value);
+      break;
+    case Kind::Cullface:
+      face.cullface = std::move(value);
+      break;
+    default:
+      break;
+    }
+    endValue();
+    return true;
+  }
+
+  bool binary(binary_t &) override {
+    endValue();
+    return true;
+  }
+
+  bool start_object(std::size_t) override {
+    Kind kind = getValueKind();
+    switch (kind) {
+    case Kind::Root:
+    case Kind::Textures:
+    case Kind::Faces:
+    case Kind::Rotation:
+      break;
+    case Kind::Element:
+      element = ModelElement();
+      facesWithoutUv.clear();
+      break;
+    case Kind::Face:
+      face = ModelFace();
+      faceHasUv = false;
+      break;
+    default:
+      kind = Kind::Skip;
+      break;
+    }
+    stack.push_back({kind});
+    return true;
+  }
+
+  bool key(string_t &value) override {
+    Kind parentKind = stack.back().kind;
+    next = Kind::Skip;
+    switch (parentKind) {
+    case Kind::Root:
+      if (value == "parent") {
+        next = Kind::Parent;
+      } else if (value == "textures") {
+        next = Kind::Textures;
+      } else if (value == "elements") {
+        next = Kind::Elements;
+        hasElements = true;
+      }
+      break;
+    case Kind::Textures:
+      next = Kind::Texture;
+      break;
+    case Kind::Element:
+      if (value == "from") {
+        next = Kind::From;
+      } else if (value == "to") {
+        next = Kind::To;
+      } else if (value == "rotation") {
+        next = Kind::Rotation;
+      } else if (value == "faces") {
+        next = Kind::Faces;
+      }
+      break;
+    case Kind::Rotation:
+      if (value == "origin") {
+        next = Kind::Origin;
+      } else if (value == "axis") {
+        next = Kind::Axis;
+      } else if (value == "angle") {
+        next = Kind::Angle;
+      }
+      break;
+    case Kind::Faces:
+      next = Kind::Face;
+      break;
+    case Kind::Face:
+      if (value == "uv") {
+        next = Kind::Uv;
+        faceHasUv = true;
+      } else if (value == "texture") {
+        next = Kind::FaceTexture;
+      } else if (value == "cullface") {
+        next = Kind::Cullface;
+      } else if (value == "rotation") {
+        next = Kind::FaceRotation;
+      } else if (value == "tintindex") {
+        next = Kind::TintIndex;
+      }
+      return true;
+    default:
+      break;
+    }
+    lastKey = std::move(value);
+    return true;
+  }
+
+  bool end_object() override {
+    Kind kind = stack.back().kind;
+    stack.pop_back();
+    if (kind == Kind::Face) {
+      endFace();
+    } else if (kind == Kind::Element) {
+      endElement();
+    }
+    endValue();
+    return true;
+  }
+
+  bool start_array(std::size_t) override {
+    Kind kind = getValueKind();
+    switch (kind) {
+    case Kind::Elements:
+    case Kind::From:
+    case Kind::To:
+    case Kind::Origin:
+    case Kind::Uv:
+      break;
+    default:
+      kind = Kind::Skip;
+      break;
+    }
+    stack.push_back({kind});
+    return true;
+  }
+
+  bool end_array() override {
+    stack.pop_back();
+    endValue();
+    return true;
+  }
+
+  bool parse_error(std::size_t, const std::string &,
+                   const nlohmann::detail::exception &) override {
+    return false;
+  }
+};
+
+} // namespace
 
 void Model::loadModel(const MCPSP::ResourceLocation &location) {
   std::string path = location.resolvePath("models") + ".json";
 
+  auto start = std::chrono::steady_clock::now();
   std::ifstream file(path);
   if (!file.is_open()) {
     throw std::runtime_error("failed to open model file: " + path);
   }
+  ++fileOpenCount;
 
-  nlohmann::json json;
-  try {
-    file >> json;
-  } catch (const nlohmann::json::parse_error &e) {
+  ModelReader reader;
+  if (!nlohmann::json::sax_parse(file, &reader)) {
     throw std::runtime_error("failed to parse model file: " + path);
   }
   file.close();
+  parseSeconds += std::chrono::duration<double>(
+                      std::chrono::steady_clock::now() - start)
+                      .count();
 
   std::cout << "Loading model from: " << path << std::endl;
 
-  if (json.contains("parent")) {
-    loadModel(ResourceLocation(json["parent"]));
+  if (!reader.parent.empty()) {
+    parent = get(ResourceLocation(reader.parent));
+    elements = parent->elements;
   }
-  if (json.contains("textures")) {
-    for (auto &[key, value] : json["textures"].items()) {
-      textures[key] = value;
-    }
+  textures = std::move(reader.textures);
+  if (reader.hasElements) {
+    // Elements replace the parent's rather than adding to them
+    elements = std::make_shared<const std::vector<ModelElement>>(
+        std::move(reader.elements));
   }
-  if (json.contains("elements")) {
-    for (const auto &element : json["elements"]) {
-      ModelElement modelElement;
-
-      modelElement.from = {element["from"][0], element["from"][1],
-                           element["from"][2]};
-      modelElement.to = {element["to"][0], element["to"][1], element["to"][2]};
-
-      modelElement.from.x /= 16.0f;
-      modelElement.from.y /= 16.0f;
-      modelElement.from.z /= 16.0f;
-      modelElement.to.x /= 16.0f;
-      modelElement.to.y /= 16.0f;
-      modelElement.to.z /= 16.0f;
-
-      if (element.contains("rotation")) {
-        modelElement.rotation.origin = {element["rotation"]["origin"][0],
-                                        element["rotation"]["origin"][1],
-                                        element["rotation"]["origin"][2]};
-
-        modelElement.rotation.origin.x /= 16.0f;
-        modelElement.rotation.origin.y /= 16.0f;
-        modelElement.rotation.origin.z /= 16.0f;
-
-        modelElement.rotation.axis = element["rotation"]["axis"];
-        modelElement.rotation.angle = element["rotation"]["angle"];
-      }
+}
 
-      if (element.contains("faces")) {
-        for (const auto &[direction, face] : element["faces"].items()) {
-          ModelFace modelFace;
-
-          Vector2 uv1;
-          Vector2 uv2;
-          if (face.contains("uv")) {
-            uv1 = {face["uv"][0], face["uv"][1]};
-            uv2 = {face["uv"][2], face["uv"][3]};
-
-            uv1.x /= 16.0f;
-            uv1.y /= 16.0f;
-            uv2.x /= 16.0f;
-            uv2.y /= 16.0f;
-          } else {
-            // Generate UVs based on model coordinates
-            // Note: from/to are already normalized to 0-1 range (divided by 16)
-            if (direction == "north") {
-              uv1 = {modelElement.to.x, 1.0f - modelElement.to.y}; // Top-right
-              uv2 = {modelElement.from.x,
-                     1.0f - modelElement.from.y}; // Bottom-left
-            } else if (direction == "south") {
-              uv1 = {modelElement.from.x, 1.0f - modelElement.to.y}; // Top-left
-              uv2 = {modelElement.to.x,
-                     1.0f - modelElement.from.y}; // Bottom-right
-            } else if (direction == "west") {
-              uv1 = {modelElement.to.z, 1.0f - modelElement.to.y}; // Top-right
-              uv2 = {modelElement.from.z,
-                     1.0f - modelElement.from.y}; // Bottom-left
-            } else if (direction == "east") {
-              uv1 = {modelElement.from.z, 1.0f - modelElement.to.y}; // Top-left
-              uv2 = {modelElement.to.z,
-                     1.0f - modelElement.from.y}; // Bottom-right
-            } else if (direction == "up") {
-              uv1 = {modelElement.from.x, modelElement.from.z}; // Top-left
-              uv2 = {modelElement.to.x, modelElement.to.z};     // Bottom-right
-            } else if (direction == "down") {
-              uv1 = {modelElement.from.x, modelElement.to.z}; // Top-left
-              uv2 = {modelElement.to.x, modelElement.from.z}; // Bottom-right
-            }
-          }
-          std::swap(uv1.x, uv2.x);
-
-          modelFace.uv1 = uv1;
-          modelFace.uv2 = uv2;
-
-          if (face.contains("texture")) {
-            modelFace.texture = face["texture"];
-          }
-
-          if (face.contains("cullface")) {
-            modelFace.cullface = face["cullface"];
-          }
-
-          if (face.contains("rotation")) {
-            modelFace.rotation = face["rotation"];
-          }
-
-          if (face.contains("tintindex")) {
-            modelFace.tintindex = face["tintindex"];
-          }
-
-          modelElement.faces[direction] = modelFace;
-        }
-
-        elements.push_back(modelElement);
-      }
+const std::string *Model::findTexture(const std::string &name) const {
+  for (const Model *model = this; model != nullptr;
+       model = model->parent.get()) {
+    auto it = model->textures.find(name);
+    if (it != model->textures.end()) {
+      return &it->second;
     }
   }
+  return nullptr;
 }
 
 ResourceLocation Model::resolveTexture(const std::string &texture) const {
+  // Variables are always looked up from this model, so that it can override
+  // the textures its parents refer to
   if (texture.find("#") != std::string::npos) {
-    return resolveTexture(textures.at(texture.substr(1)));
+    const std::string *value = findTexture(texture.substr(1));
+    if (value == nullptr) {
+      throw std::runtime_error("undefined texture variable: " + texture);
+    }
+    return resolveTexture(*value);
   }
   return ResourceLocation(texture);
 }
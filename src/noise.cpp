@@ -0,0 +1,260 @@
+#include "noise.hpp"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+// The kernels below only agree bit for bit if the compiler doesn't fuse
+// multiplies and adds, so this file is built with -ffp-contract=off.
+
+namespace MCPSP {
+
+// Points are gathered into fixed-size batches on the stack
+static constexpr std::size_t BATCH_SIZE = 64;
+
+// splitmix64, so the permutation doesn't depend on the standard library's
+// random number engines
+static uint64_t nextRandom(uint64_t &state) {
+  uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+  return z ^ (z >> 31);
+}
+
+GradientNoise::GradientNoise(uint64_t seed) {
+  for (int i = 0; i < 256; ++i) {
+    permutation[i] = static_cast<uint8_t>(i);
+  }
+  uint64_t state = seed;
+  for (int i = 255; i > 0; --i) {
+    int j = static_cast<int>(nextRandom(state) % (i + 1));
+    std::swap(permutation[i], permutation[j]);
+  }
+  // Doubled so that hashes of neighbouring cells never wrap
+  for (int i = 0; i < 256; ++i) {
+    permutation[i + 256] = permutation[i];
+  }
+}
+
+static float grad2(int hash, float x, float z) {
+  switch (hash & 7) {
+  case 0:
+    return x + z;
+  case 1:
+    return -x + z;
+  case 2:
+    return x - z;
+  case 3:
+    return -x - z;
+  case 4:
+    return x;
+  case 5:
+    return -x;
+  case 6:
+    return z;
+  default:
+    return -z;
+  }
+}
+
+static float grad3(int hash, float x, float y, float z) {
+  int h = hash & 15;
+  float u = h < 8 ? x : y;
+  float v = h < 4 ? y : (h == 12 || h == 14 ? x : z);
+  return ((h & 1) == 0 ? u : -u) + ((h & 2) == 0 ? v : -v);
+}
+
+// Splits a coordinate into its cell (wrapped to the table) and the offset
+// within the cell
+static int split(float value, float &fraction) {
+  float cell = std::floor(value);
+  fraction = value - cell;
+  return static_cast<int>(cell) & 255;
+}
+
+// Kernels. Each lane computes
+//   fade(t) = t * t * t * (t * (t * 6 - 15) + 10)
+//   lerp(a, b, t) = a + t * (b - a)
+// with exactly the same sequence of operations as the scalar version.
+
+static inline float fade(float t) {
+  return t * t * t * (t * (t * 6.0f - 15.0f) + 10.0f);
+}
+
+static inline float lerp(float a, float b, float t) { return a + t * (b - a); }
+
+static void interpolate2DScalar(const float *fx, const float *fz,
+                                const float *const d[4], float *out,
+                                std::size_t begin, std::size_t end) {
+  for (std::size_t i = begin; i < end; ++i) {
+    float u = fade(fx[i]);
+    float v = fade(fz[i]);
+    out[i] = lerp(lerp(d[0][i], d[1][i], u), lerp(d[2][i], d[3][i], u), v);
+  }
+}
+
+static void interpolate3DScalar(const float *fx, const float *fy,
+                                const float *fz, const float *const d[8],
+                                float *out, std::size_t begin,
+                                std::size_t end) {
+  for (std::size_t i = begin; i < end; ++i) {
+    float u = fade(fx[i]);
+    float v = fade(fy[i]);
+    float w = fade(fz[i]);
+    float y0 = lerp(lerp(d[0][i], d[1][i], u), lerp(d[2][i], d[3][i], u), v);
+    float y1 = lerp(lerp(d[4][i], d[5][i], u), lerp(d[6][i], d[7][i], u), v);
+    out[i] = lerp(y0, y1, w);
+  }
+}
+
+#if defined(__SSE2__)
+typedef __m128 Lanes;
+static inline Lanes load(const float *p) { return _mm_loadu_ps(p); }
+static inline void store(float *p, Lanes v) { _mm_storeu_ps(p, v); }
+static inline Lanes splat(float f) { return _mm_set1_ps(f); }
+static inline Lanes add(Lanes a, Lanes b) { return _mm_add_ps(a, b); }
+static inline Lanes sub(Lanes a, Lanes b) { return _mm_sub_ps(a, b); }
+static inline Lanes mul(Lanes a, Lanes b) { return _mm_mul_ps(a, b); }
+#define MCPSP_NOISE_SIMD "SSE2"
+#elif defined(__ARM_NEON)
+typedef float32x4_t Lanes;
+static inline Lanes load(const float *p) { return vld1q_f32(p); }
+static inline void store(float *p, Lanes v) { vst1q_f32(p, v); }
+static inline Lanes splat(float f) { return vdupq_n_f32(f); }
+static inline Lanes add(Lanes a, Lanes b) { return vaddq_f32(a, b); }
+static inline Lanes sub(Lanes a, Lanes b) { return vsubq_f32(a, b); }
+static inline Lanes mul(Lanes a, Lanes b) { return vmulq_f32(a, b); }
+#define MCPSP_NOISE_SIMD "NEON"
+#endif
+
+#ifdef MCPSP_NOISE_SIMD
+static inline Lanes fade(Lanes t) {
+  Lanes inner = add(mul(t, sub(mul(t, splat(6.0f)), splat(15.0f))),
+                    splat(10.0f));
+  return mul(mul(mul(t, t), t), inner);
+}
+
+static inline Lanes lerp(Lanes a, Lanes b, Lanes t) {
+  return add(a, mul(t, sub(b, a)));
+}
+
+static void interpolate2DSimd(const float *fx, const float *fz,
+                              const float *const d[4], float *out,
+                              std::size_t count) {
+  std::size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    Lanes u = fade(load(fx + i));
+    Lanes v = fade(load(fz + i));
+    Lanes x0 = lerp(load(d[0] + i), load(d[1] + i), u);
+    Lanes x1 = lerp(load(d[2] + i), load(d[3] + i), u);
+    store(out + i, lerp(x0, x1, v));
+  }
+  interpolate2DScalar(fx, fz, d, out, i, count);
+}
+
+static void interpolate3DSimd(const float *fx, const float *fy,
+                              const float *fz, const float *const d[8],
+                              float *out, std::size_t count) {
+  std::size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    Lanes u = fade(load(fx + i));
+    Lanes v = fade(load(fy + i));
+    Lanes w = fade(load(fz + i));
+    Lanes y0 = lerp(lerp(load(d[0] + i), load(d[1] + i), u),
+                    lerp(load(d[2] + i), load(d[3] + i), u), v);
+    Lanes y1 = lerp(lerp(load(d[4] + i), load(d[5] + i), u),
+                    lerp(load(d[6] + i), load(d[7] + i), u), v);
+    store(out + i, lerp(y0, y1, w));
+  }
+  interpolate3DScalar(fx, fy, fz, d, out, i, count);
+}
+#endif
+
+const char *GradientNoise::getSimdKernelName() {
+#ifdef MCPSP_NOISE_SIMD
+  return MCPSP_NOISE_SIMD;
+#else
+  // The VFPU isn't used: it doesn't round like the FPU, which would make
+  // terrain depend on the platform
+  return "scalar";
+#endif
+}
+
+void GradientNoise::sample2D(const float *x, const float *z, float *out,
+                             std::size_t count, NoiseKernel kernel) const {
+  const uint8_t *p = permutation;
+  float fx[BATCH_SIZE], fz[BATCH_SIZE];
+  float corners[4][BATCH_SIZE];
+  const float *const d[4] = {corners[0], corners[1], corners[2], corners[3]};
+
+  for (std::size_t start = 0; start < count; start += BATCH_SIZE) {
+    std::size_t n = std::min(BATCH_SIZE, count - start);
+
+    // Gather the gradient of each cell corner, dotted with the offset to it
+    for (std::size_t i = 0; i < n; ++i) {
+      int cx = split(x[start + i], fx[i]);
+      int cz = split(z[start + i], fz[i]);
+      int a = p[cx] + cz;
+      int b = p[cx + 1] + cz;
+      corners[0][i] = grad2(p[a], fx[i], fz[i]);
+      corners[1][i] = grad2(p[b], fx[i] - 1.0f, fz[i]);
+      corners[2][i] = grad2(p[a + 1], fx[i], fz[i] - 1.0f);
+      corners[3][i] = grad2(p[b + 1], fx[i] - 1.0f, fz[i] - 1.0f);
+    }
+
+#ifdef MCPSP_NOISE_SIMD
+    if (kernel == NoiseKernel::Simd) {
+      interpolate2DSimd(fx, fz, d, out + start, n);
+      continue;
+    }
+#endif
+    interpolate2DScalar(fx, fz, d, out + start, 0, n);
+  }
+}
+
+void GradientNoise::sample3D(const float *x, const float *y, const float *z,
+                             float *out, std::size_t count,
+                             NoiseKernel kernel) const {
+  const uint8_t *p = permutation;
+  float fx[BATCH_SIZE], fy[BATCH_SIZE], fz[BATCH_SIZE];
+  float corners[8][BATCH_SIZE];
+  const float *const d[8] = {corners[0], corners[1], corners[2], corners[3],
+                             corners[4], corners[5], corners[6], corners[7]};
+
+  for (std::size_t start = 0; start < count; start += BATCH_SIZE) {
+    std::size_t n = std::min(BATCH_SIZE, count - start);
+
+    for (std::size_t i = 0; i < n; ++i) {
+      int cx = split(x[start + i], fx[i]);
+      int cy = split(y[start + i], fy[i]);
+      int cz = split(z[start + i], fz[i]);
+      int a = p[cx] + cy;
+      int b = p[cx + 1] + cy;
+      int aa = p[a] + cz, ab = p[a + 1] + cz;
+      int ba = p[b] + cz, bb = p[b + 1] + cz;
+      float x1 = fx[i] - 1.0f, y1 = fy[i] - 1.0f, z1 = fz[i] - 1.0f;
+      corners[0][i] = grad3(p[aa], fx[i], fy[i], fz[i]);
+      corners[1][i] = grad3(p[ba], x1, fy[i], fz[i]);
+      corners[2][i] = grad3(p[ab], fx[i], y1, fz[i]);
+      corners[3][i] = grad3(p[bb], x1, y1, fz[i]);
+      corners[4][i] = grad3(p[aa + 1], fx[i], fy[i], z1);
+      corners[5][i] = grad3(p[ba + 1], x1, fy[i], z1);
+      corners[6][i] = grad3(p[ab + 1], fx[i], y1, z1);
+      corners[7][i] = grad3(p[bb + 1], x1, y1, z1);
+    }
+
+#ifdef MCPSP_NOISE_SIMD
+    if (kernel == NoiseKernel::Simd) {
+      interpolate3DSimd(fx, fy, fz, d, out + start, n);
+      continue;
+    }
+#endif
+    interpolate3DScalar(fx, fy, fz, d, out + start, 0, n);
+  }
+}
+
+} // namespace MCPSP
@@ -0,0 +1,220 @@
+#include "region_file.hpp"
+#include "byte_buffer.hpp"
+#include "chunk.hpp"
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <sys/stat.h>
+
+#ifndef __PSP__
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace MCPSP {
+
+static const char REGION_MAGIC[4] = {'M', 'C', 'P', 'R'};
+static constexpr std::size_t HEADER_SIZE =
+    8 + RegionFile::CHUNK_COUNT * 2 * sizeof(uint32_t);
+
+RegionFile::~RegionFile() {
+#ifndef __PSP__
+  unmap();
+#endif
+  if (file != nullptr) {
+    std::fclose(file);
+  }
+}
+
+#ifndef __PSP__
+void RegionFile::unmap() {
+  if (mapping != nullptr) {
+    munmap(const_cast<uint8_t *>(mapping), mappingSize);
+    mapping = nullptr;
+    mappingSize = 0;
+  }
+}
+
+void RegionFile::map() {
+  struct stat info;
+  if (fstat(fileno(file), &info) != 0 || info.st_size == 0) {
+    return;
+  }
+  void *address = mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED,
+                       fileno(file), 0);
+  if (address != MAP_FAILED) {
+    mapping = static_cast<const uint8_t *>(address);
+    mappingSize = info.st_size;
+  }
+}
+#endif
+
+std::unique_ptr<RegionFile> RegionFile::open(const std::string &path,
+                                             bool create) {
+  std::unique_ptr<RegionFile> region(new RegionFile());
+  region->file = std::fopen(path.c_str(), "r+b");
+  if (region->file == nullptr) {
+    if (!create) {
+      return nullptr;
+    }
+    region->file = std::fopen(path.c_str(), "w+b");
+    if (region->file == nullptr) {
+      throw std::runtime_error("failed to create region file: " + path);
+    }
+
+    // Write an empty header
+    std::vector<uint8_t> header(REGION_MAGIC, REGION_MAGIC + 4);
+    ByteWriter out(header);
+    out.u32(VERSION);
+    header.resize(HEADER_SIZE, 0);
+    std::fwrite(header.data(), 1, header.size(), region->file);
+  } else {
+    std::vector<uint8_t> header(HEADER_SIZE);
+    if (std::fread(header.data(), 1, HEADER_SIZE, region->file) !=
+            HEADER_SIZE ||
+        std::memcmp(header.data(), REGION_MAGIC, 4) != 0) {
+      throw std::runtime_error("not a region file: " + path);
+    }
+
+    ByteReader in(header.data() + 4, HEADER_SIZE - 4);
+    if (in.u32() != VERSION) {
+      throw std::runtime_error("unsupported region file version: " + path);
+    }
+    for (Entry &entry : region->entries) {
+      entry.offset = in.u32();
+      entry.length = in.u32();
+    }
+  }
+
+#ifndef __PSP__
+  region->map();
+#endif
+  return region;
+}
+
+bool RegionFile::read(int x, int z, Record &record) {
+  const Entry &entry = entries[z * REGION_SIZE + x];
+  if (entry.length == 0) {
+    return false;
+  }
+
+#ifdef __PSP__
+  buffer.resize(entry.length);
+  if (std::fseek(file, entry.offset, SEEK_SET) != 0 ||
+      std::fread(buffer.data(), 1, entry.length, file) != entry.length) {
+    throw std::runtime_error("failed to read chunk from region file");
+  }
+  record.data = buffer.data();
+#else
+  if (mapping == nullptr) {
+    map();
+  }
+  if (mapping == nullptr || entry.offset + entry.length > mappingSize) {
+    throw std::runtime_error("chunk lies outside the region file");
+  }
+  record.data = mapping + entry.offset;
+#endif
+  record.size = entry.length;
+  return true;
+}
+
+void RegionFile::write(int x, int z, const std::vector<uint8_t> &data) {
+  int index = z * REGION_SIZE + x;
+  Entry &entry = entries[index];
+
+  // Reuse the old space if the chunk still fits, otherwise append
+  if (data.size() > entry.length) {
+    std::fseek(file, 0, SEEK_END);
+    entry.offset = static_cast<uint32_t>(std::ftell(file));
+  } else {
+    std::fseek(file, entry.offset, SEEK_SET);
+  }
+  entry.length = static_cast<uint32_t>(data.size());
+  if (std::fwrite(data.data(), 1, data.size(), file) != data.size()) {
+    throw std::runtime_error("failed to write chunk to region file");
+  }
+
+  std::vector<uint8_t> header;
+  ByteWriter out(header);
+  out.u32(entry.offset);
+  out.u32(entry.length);
+  std::fseek(file, 8 + index * 2 * sizeof(uint32_t), SEEK_SET);
+  std::fwrite(header.data(), 1, header.size(), file);
+
+  std::fflush(file);
+#ifndef __PSP__
+  // The mapping doesn't grow with the file, so map it again on the next read
+  unmap();
+#endif
+}
+
+// Region coordinates round towards negative infinity
+static int getRegionCoordinate(int chunk) {
+  return chunk >= 0 ? chunk / RegionFile::REGION_SIZE
+                    : (chunk + 1) / RegionFile::REGION_SIZE - 1;
+}
+
+static int getLocalCoordinate(int chunk) {
+  return chunk - getRegionCoordinate(chunk) * RegionFile::REGION_SIZE;
+}
+
+RegionFile *RegionStorage::getRegion(int chunkX, int chunkZ, bool create) {
+  ChunkPosition region{getRegionCoordinate(chunkX),
+                       getRegionCoordinate(chunkZ)};
+  auto it = regions.find(region);
+  if (it != regions.end()) {
+    return it->second.get();
+  }
+
+  if (create) {
+    mkdir(directory.c_str(), 0777);
+  }
+  std::string path = directory + "/r." + std::to_string(region.x) + "." +
+                     std::to_string(region.z) + ".mcpr";
+  std::unique_ptr<RegionFile> file = RegionFile::open(path, create);
+  if (file == nullptr) {
+    return nullptr;
+  }
+  return (regions[region] = std::move(file)).get();
+}
+
+bool RegionStorage::loadChunk(Chunk &chunk) {
+  if (!isEnabled()) {
+    return false;
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  RegionFile *region = getRegion(chunk.getChunkX(), chunk.getChunkZ(), false);
+  RegionFile::Record record;
+  if (region == nullptr ||
+      !region->read(getLocalCoordinate(chunk.getChunkX()),
+                    getLocalCoordinate(chunk.getChunkZ()), record)) {
+    return false;
+  }
+
+  ByteReader in(record.data, record.size);
+  chunk.read(in);
+  chunk.clearModified();
+
+  ++chunksRead;
+  bytesRead += record.size;
+  readSeconds += std::chrono::duration<double>(
+                     std::chrono::steady_clock::now() - start)
+                     .count();
+  return true;
+}
+
+void RegionStorage::saveChunk(const Chunk &chunk) {
+  if (!isEnabled()) {
+    return;
+  }
+
+  writeBuffer.clear();
+  ByteWriter out(writeBuffer);
+  chunk.write(out);
+  getRegion(chunk.getChunkX(), chunk.getChunkZ(), true)
+      ->write(getLocalCoordinate(chunk.getChunkX()),
+              getLocalCoordinate(chunk.getChunkZ()), writeBuffer);
+}
+
+} // namespace MCPSP
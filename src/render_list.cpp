@@ -0,0 +1,150 @@
+#include "render_list.hpp"
+#include "rlgl.h"
+#include <GL/gl.h>
+#include <algorithm>
+#include <cstring>
+
+namespace MCPSP {
+
+void RenderList::add(uint8_t state, TextureHandle texture, const Mesh &mesh,
+                     const Vector3 &origin, float distance) {
+  DrawItem item;
+  item.key = 0;
+  std::memcpy(&item.depth, &distance, sizeof(item.depth));
+  item.state = state;
+  item.texture = texture;
+  item.mesh = &mesh;
+  item.origin = origin;
+  items.push_back(item);
+}
+
+void RenderList::sort(DrawOrder order) {
+  for (DrawItem &item : items) {
+    uint64_t state = static_cast<uint64_t>(item.state) << 48;
+    if (item.state & RENDER_BLEND) {
+      item.key = state | static_cast<uint64_t>(~item.depth) << 16 | item.texture;
+    } else if (order == DrawOrder::ByTexture) {
+      item.key = state | static_cast<uint64_t>(item.texture) << 32 | item.depth;
+    } else {
+      item.key = state | static_cast<uint64_t>(item.depth) << 16 | item.texture;
+    }
+  }
+  std::sort(items.begin(), items.end(),
+            [](const DrawItem &a, const DrawItem &b) { return a.key < b.key; });
+}
+
+RenderList::SubmitStats RenderList::submit(RenderBackend &backend) const {
+  SubmitStats stats;
+  if (items.empty()) {
+    return stats;
+  }
+
+  backend.begin();
+  const DrawItem *previous = nullptr;
+  for (const DrawItem &item : items) {
+    if (previous == nullptr || item.state != previous->state) {
+      backend.setState(item.state);
+      ++stats.stateChanges;
+    }
+    if (previous == nullptr || item.texture != previous->texture) {
+      backend.bindTexture(item.texture);
+      ++stats.textureBinds;
+    }
+    if (previous == nullptr || item.origin.x != previous->origin.x ||
+        item.origin.y != previous->origin.y ||
+        item.origin.z != previous->origin.z) {
+      backend.setOrigin(item.origin);
+    }
+    backend.drawMesh(*item.mesh);
+    ++stats.drawCalls;
+    previous = &item;
+  }
+  backend.end();
+  return stats;
+}
+
+void GLRenderBackend::begin() {
+  // Undo the fixed point scaling of chunk texture coordinates
+  glMatrixMode(GL_TEXTURE);
+  glPushMatrix();
+  glLoadIdentity();
+  glScalef(1.0f / VERTEX_UV_SCALE, 1.0f / VERTEX_UV_SCALE, 1.0f);
+  glMatrixMode(GL_MODELVIEW);
+
+  glEnableClientState(GL_VERTEX_ARRAY);
+  glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+  glEnableClientState(GL_COLOR_ARRAY);
+
+  // setOrigin replaces the top of the stack for each section
+  rlPushMatrix();
+}
+
+void GLRenderBackend::setState(uint8_t state) {
+  if (state & RENDER_ALPHA_TEST) {
+    glEnable(GL_ALPHA_TEST);
+    glAlphaFunc(GL_GREATER, 0.1f); // Discard pixels with alpha < 0.1
+  } else {
+    glDisable(GL_ALPHA_TEST);
+  }
+
+  // raylib leaves blending on, which costs the GE a framebuffer read for
+  // every pixel of opaque geometry
+  if (state & RENDER_BLEND) {
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glDepthMask(GL_FALSE);
+  } else {
+    glDisable(GL_BLEND);
+    glDepthMask(GL_TRUE);
+  }
+}
+
+void GLRenderBackend::bindTexture(TextureHandle texture) {
+  rlSetTexture(TextureManager::get(texture).id);
+}
+
+void GLRenderBackend::setOrigin(const Vector3 &origin) {
+  rlPopMatrix();
+  rlPushMatrix();
+  rlTranslatef(origin.x, origin.y, origin.z);
+
+  // Undo the fixed point scaling of chunk vertices
+  rlScalef(1.0f / VERTEX_POSITION_SCALE, 1.0f / VERTEX_POSITION_SCALE,
+           1.0f / VERTEX_POSITION_SCALE);
+}
+
+void GLRenderBackend::drawMesh(const Mesh &mesh) {
+  const uint16_t *indices = getQuadIndices();
+
+  // 16-bit indices only reach QUAD_BATCH_SIZE quads, so draw large meshes
+  // in batches
+  std::size_t quadCount = mesh.vertices.size() / 4;
+  for (std::size_t first = 0; first < quadCount; first += QUAD_BATCH_SIZE) {
+    const ChunkVertex *base = &mesh.vertices[first * 4];
+    std::size_t count = std::min(QUAD_BATCH_SIZE, quadCount - first);
+    glTexCoordPointer(2, GL_SHORT, sizeof(ChunkVertex), &base->u);
+    glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(ChunkVertex), &base->color);
+    glVertexPointer(3, GL_SHORT, sizeof(ChunkVertex), &base->x);
+    glDrawElements(GL_TRIANGLES, count * 6, GL_UNSIGNED_SHORT, indices);
+  }
+}
+
+void GLRenderBackend::end() {
+  rlPopMatrix();
+
+  glDisableClientState(GL_VERTEX_ARRAY);
+  glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+  glDisableClientState(GL_COLOR_ARRAY);
+  glDisable(GL_ALPHA_TEST);
+  // Back to raylib's defaults for whatever is drawn next
+  glEnable(GL_BLEND);
+  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+  glDepthMask(GL_TRUE);
+  rlSetTexture(0);
+
+  glMatrixMode(GL_TEXTURE);
+  glPopMatrix();
+  glMatrixMode(GL_MODELVIEW);
+}
+
+} // namespace MCPSP
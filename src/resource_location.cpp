@@ -0,0 +1,63 @@
+#include "resource_location.hpp"
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+namespace MCPSP {
+
+std::string ResourceLocation::assetRoot = "umd0:/assets";
+
+struct ResourceLocation::Table {
+  std::vector<Entry> entries;
+  std::unordered_map<std::string, uint16_t> ids;
+
+  Table() {
+    // Reserve AIR_ID before anything else gets interned
+    entries.push_back({"minecraft", "air"});
+    ids["minecraft:air"] = AIR_ID;
+  }
+};
+
+ResourceLocation::Table &ResourceLocation::getTable() {
+  // Constructed on first use so that static ResourceLocations in other
+  // translation units can be interned safely.
+  static Table table;
+  return table;
+}
+
+const ResourceLocation::Entry &ResourceLocation::getEntry(uint16_t id) {
+  return getTable().entries[id];
+}
+
+uint16_t ResourceLocation::intern(const std::string &ns,
+                                  const std::string &path) {
+  Table &table = getTable();
+  std::string key = ns + ":" + path;
+  auto it = table.ids.find(key);
+  if (it != table.ids.end()) {
+    return it->second;
+  }
+
+  if (table.entries.size() > UINT16_MAX) {
+    throw std::runtime_error("too many resource locations: " + key);
+  }
+  uint16_t id = static_cast<uint16_t>(table.entries.size());
+  table.entries.push_back({ns, path});
+  table.ids.emplace(std::move(key), id);
+  return id;
+}
+
+ResourceLocation::ResourceLocation(const std::string &nid) {
+  std::size_t colon = nid.find(':');
+  if (colon == std::string::npos) {
+    id = intern("minecraft", nid);
+  } else {
+    id = intern(nid.substr(0, colon), nid.substr(colon + 1));
+  }
+}
+
+std::size_t ResourceLocation::getInternedCount() {
+  return getTable().entries.size();
+}
+
+} // namespace MCPSP
@@ -0,0 +1,92 @@
+#include "terrain_generator.hpp"
+#include "chunk.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <vector>
+
+namespace MCPSP {
+
+void TerrainGenerator::generateHeightmap(int chunkX, int chunkZ,
+                                         float heights[256]) const {
+  float x[256], z[256], noise[256];
+  float frequency = 1.0f / 64.0f;
+  float amplitude = 12.0f;
+
+  std::fill(heights, heights + 256, static_cast<float>(SEA_LEVEL));
+  for (int octave = 0; octave < OCTAVES; ++octave) {
+    for (int i = 0; i < 256; ++i) {
+      x[i] = (chunkX * 16 + i % 16) * frequency;
+      z[i] = (chunkZ * 16 + i / 16) * frequency;
+    }
+    heightNoise.sample2D(x, z, noise, 256);
+    for (int i = 0; i < 256; ++i) {
+      heights[i] += noise[i] * amplitude;
+    }
+    frequency *= 2.0f;
+    amplitude *= 0.5f;
+  }
+}
+
+void TerrainGenerator::generate(Chunk &chunk) {
+  auto start = std::chrono::steady_clock::now();
+
+  const BlockState bedrock{ResourceLocation("minecraft:bedrock")};
+  const BlockState dirt{ResourceLocation("minecraft:dirt")};
+  const BlockState grass{ResourceLocation("minecraft:grass_block")};
+
+  float heights[256];
+  generateHeightmap(chunk.getChunkX(), chunk.getChunkZ(), heights);
+
+  // Solid blocks of each column, indexed by (y * 16 + z) * 16 + x
+  std::vector<uint8_t> solid(256 * Chunk::HEIGHT, 0);
+  int maxHeight = 0;
+  for (int i = 0; i < 256; ++i) {
+    int height = std::clamp(static_cast<int>(std::floor(heights[i])), 1,
+                            Chunk::HEIGHT - 2);
+    maxHeight = std::max(maxHeight, height);
+    for (int y = 0; y <= height; ++y) {
+      solid[y * 256 + i] = 1;
+    }
+  }
+
+  if (densityEnabled) {
+    // Density falls off with height above the surface, and noise pushes it
+    // either way, leaving overhangs above and caves below
+    float x[256], y[256], z[256], noise[256];
+    int top = std::min(maxHeight + 8, Chunk::HEIGHT - 1);
+    for (int layer = 1; layer <= top; ++layer) {
+      for (int i = 0; i < 256; ++i) {
+        x[i] = (chunk.getChunkX() * 16 + i % 16) / 24.0f;
+        y[i] = layer / 16.0f;
+        z[i] = (chunk.getChunkZ() * 16 + i / 16) / 24.0f;
+      }
+      densityNoise.sample3D(x, y, z, noise, 256);
+      for (int i = 0; i < 256; ++i) {
+        float density = (heights[i] - layer) / 8.0f + noise[i];
+        solid[layer * 256 + i] = density > 0.0f;
+      }
+    }
+  }
+
+  // Only solid blocks are written, since new chunks are all air
+  for (int i = 0; i < 256; ++i) {
+    int x = i % 16;
+    int z = i / 16;
+    chunk.setGeneratedBlock(x, 0, z, bedrock);
+    for (int y = 1; y < Chunk::HEIGHT; ++y) {
+      if (!solid[y * 256 + i]) {
+        continue;
+      }
+      bool exposed = y + 1 == Chunk::HEIGHT || !solid[(y + 1) * 256 + i];
+      chunk.setGeneratedBlock(x, y, z, exposed ? grass : dirt);
+    }
+  }
+
+  ++chunksGenerated;
+  generateSeconds += std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+}
+
+} // namespace MCPSP
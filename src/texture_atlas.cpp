@@ -0,0 +1,124 @@
+#include "texture_atlas.hpp"
+#include "texture_manager.hpp"
+#include <algorithm>
+#include <iostream>
+#include <string>
+
+namespace MCPSP {
+
+namespace {
+
+struct Tile {
+  ResourceLocation texture;
+  Image image;
+  int x, y, page;
+};
+
+// Copies a tile into the page along with its edge-extended padding.
+void blitTile(Color *page, const Tile &tile) {
+  const Color *pixels = static_cast<const Color *>(tile.image.data);
+  int size = TextureAtlas::PAGE_SIZE;
+  int padding = TextureAtlas::PADDING;
+  for (int y = -padding; y < tile.image.height + padding; ++y) {
+    int sy = std::clamp(y, 0, tile.image.height - 1);
+    for (int x = -padding; x < tile.image.width + padding; ++x) {
+      int sx = std::clamp(x, 0, tile.image.width - 1);
+      page[(tile.y + y) * size + (tile.x + x)] =
+          pixels[sy * tile.image.width + sx];
+    }
+  }
+}
+
+} // namespace
+
+void TextureAtlas::addTexture(const ResourceLocation &texture) {
+  if (std::find(textures.begin(), textures.end(), texture) == textures.end()) {
+    textures.push_back(texture);
+  }
+}
+
+void TextureAtlas::stitch() {
+  std::vector<Tile> tiles;
+  for (const ResourceLocation &texture : textures) {
+    std::string path = texture.resolvePath("textures") + ".png";
+    Image image = LoadImage(path.c_str());
+    if (image.data == nullptr) {
+      std::cout << "Atlas: failed to load " << path << std::endl;
+      continue;
+    }
+    ImageFormat(&image, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+
+    // Animated textures are vertical strips of frames; keep the first one
+    if (image.height > image.width) {
+      image.height = image.width;
+    }
+
+    if (image.width + 2 * PADDING > PAGE_SIZE ||
+        image.height + 2 * PADDING > PAGE_SIZE) {
+      std::cout << "Atlas: " << path << " is too large" << std::endl;
+      UnloadImage(image);
+      continue;
+    }
+    tiles.push_back({texture, image, 0, 0, 0});
+  }
+
+  // Shelf packing, tallest tiles first
+  std::sort(tiles.begin(), tiles.end(), [](const Tile &a, const Tile &b) {
+    return a.image.height > b.image.height;
+  });
+
+  int page = 0, shelfX = 0, shelfY = 0, shelfHeight = 0;
+  for (Tile &tile : tiles) {
+    int cellWidth = tile.image.width + 2 * PADDING;
+    int cellHeight = tile.image.height + 2 * PADDING;
+    if (shelfX + cellWidth > PAGE_SIZE) {
+      shelfX = 0;
+      shelfY += shelfHeight;
+      shelfHeight = 0;
+    }
+    if (shelfY + cellHeight > PAGE_SIZE) {
+      ++page;
+      shelfX = shelfY = shelfHeight = 0;
+    }
+    tile.x = shelfX + PADDING;
+    tile.y = shelfY + PADDING;
+    tile.page = page;
+    shelfX += cellWidth;
+    shelfHeight = std::max(shelfHeight, cellHeight);
+  }
+
+  int pageCount = tiles.empty() ? 0 : page + 1;
+  for (int i = 0; i < pageCount; ++i) {
+    Image pageImage = GenImageColor(PAGE_SIZE, PAGE_SIZE, {0, 0, 0, 0});
+    Color *pixels = static_cast<Color *>(pageImage.data);
+    std::vector<MipTile> mipTiles;
+    for (const Tile &tile : tiles) {
+      if (tile.page == i) {
+        blitTile(pixels, tile);
+        mipTiles.push_back(
+            {tile.x, tile.y, tile.image.width, tile.image.height, PADDING});
+      }
+    }
+
+    ResourceLocation location(std::string(name) + "_" + std::to_string(i));
+    TextureManager::registerImage(location, pageImage, mipTiles);
+    UnloadImage(pageImage);
+    pages.push_back(location);
+  }
+
+  for (Tile &tile : tiles) {
+    AtlasRegion region;
+    region.page = pages[tile.page];
+    region.uvMin = {static_cast<float>(tile.x) / PAGE_SIZE,
+                    static_cast<float>(tile.y) / PAGE_SIZE};
+    region.uvMax = {static_cast<float>(tile.x + tile.image.width) / PAGE_SIZE,
+                    static_cast<float>(tile.y + tile.image.height) / PAGE_SIZE};
+    regions[tile.texture] = region;
+    UnloadImage(tile.image);
+  }
+
+  std::cout << "Atlas: stitched " << tiles.size() << " textures into "
+            << pageCount << " page(s)" << std::endl;
+}
+
+} // namespace MCPSP
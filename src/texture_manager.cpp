@@ -1,7 +1,275 @@
 #include "texture_manager.hpp"
+#define GL_GLEXT_PROTOTYPES
+#include <GL/gl.h>
+#include <GL/glext.h>
+#include <chrono>
+#include <stdexcept>
 
 namespace MCPSP {
 
-std::unordered_map<std::string, Texture2D> TextureManager::textureCache;
+std::vector<TextureManager::Slot> TextureManager::slots;
+std::unordered_map<ResourceLocation, TextureHandle> TextureManager::handles;
+std::size_t TextureManager::budget = TextureManager::DEFAULT_BUDGET;
+std::size_t TextureManager::residentBytes = 0;
+std::size_t TextureManager::residentRgbaBytes = 0;
+bool TextureManager::palettized = true;
+bool TextureManager::mipmapped = true;
+uint32_t TextureManager::frame = 0;
+TextureManager::Stats TextureManager::stats;
 
+namespace {
+
+// One mip level in the form it is uploaded in
+struct UploadLevel {
+  int width;
+  int height;
+  std::vector<uint8_t> data;
+};
+
+std::vector<uint8_t> toBytes(const Color *pixels, std::size_t count) {
+  const uint8_t *bytes = reinterpret_cast<const uint8_t *>(pixels);
+  return std::vector<uint8_t>(bytes, bytes + count * sizeof(Color));
+}
+
+// Indexed textures are GL_COLOR_INDEX data to pspgl, with the lookup table
+// attached to the bound texture object by glColorTableEXT. Every level shares
+// the palette of the base level.
+Texture2D uploadLevels(const std::vector<UploadLevel> &levels,
+                       const IndexedImage *indexed) {
+  Texture2D texture = {};
+  glGenTextures(1, &texture.id);
+  glBindTexture(GL_TEXTURE_2D, texture.id);
+
+  GLint internalFormat = GL_RGBA;
+  GLenum format = GL_RGBA;
+  if (indexed != nullptr) {
+    internalFormat = indexed->format == ClutFormat::Clut4 ? GL_COLOR_INDEX4_EXT
+                                                          : GL_COLOR_INDEX8_EXT;
+    format = GL_COLOR_INDEX;
+  }
+  for (std::size_t level = 0; level < levels.size(); ++level) {
+    glTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), internalFormat,
+                 levels[level].width, levels[level].height, 0, format,
+                 GL_UNSIGNED_BYTE, levels[level].data.data());
+  }
+  if (indexed != nullptr) {
+    glColorTableEXT(GL_TEXTURE_2D, GL_RGBA,
+                    static_cast<GLsizei>(indexed->palette.size()), GL_RGBA,
+                    GL_UNSIGNED_BYTE, indexed->palette.data());
+  }
+
+  // Same sampling as raylib's own uploads, picking the nearest level when
+  // there are several
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+                  levels.size() > 1 ? GL_NEAREST_MIPMAP_NEAREST : GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  texture.width = levels[0].width;
+  texture.height = levels[0].height;
+  texture.mipmaps = static_cast<int>(levels.size());
+  // raylib has no indexed formats. Nothing draws differently based on this;
+  // sizes are tracked by the TextureManager instead.
+  texture.format = indexed != nullptr ? PIXELFORMAT_UNCOMPRESSED_GRAYSCALE
+                                      : PIXELFORMAT_UNCOMPRESSED_R8G8B8A8;
+  return texture;
+}
+
+} // namespace
+
+TextureHandle TextureManager::getHandle(const ResourceLocation &location) {
+  auto it = handles.find(location);
+  if (it != handles.end()) {
+    return it->second;
+  }
+
+  if (slots.size() > UINT16_MAX) {
+    throw std::runtime_error("too many textures: " +
+                             static_cast<std::string>(location));
+  }
+  TextureHandle handle = static_cast<TextureHandle>(slots.size());
+  slots.push_back({location});
+  handles.emplace(location, handle);
+  return handle;
+}
+
+TextureHandle TextureManager::registerTexture(const ResourceLocation &location,
+                                              const Texture2D &texture) {
+  TextureHandle handle = getHandle(location);
+  Slot &slot = slots[handle];
+  if (slot.loaded) {
+    unload(slot);
+  }
+  slot.texture = texture;
+  slot.loaded = true;
+  slot.pinned = true;
+  slot.bytes = GetPixelDataSize(texture.width, texture.height, texture.format);
+  slot.rgbaBytes = GetPixelDataSize(texture.width, texture.height,
+                                    PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+  residentBytes += slot.bytes;
+  residentRgbaBytes += slot.rgbaBytes;
+  return handle;
+}
+
+TextureHandle TextureManager::registerImage(const ResourceLocation &location,
+                                            const Image &image,
+                                            const std::vector<MipTile> &tiles) {
+  TextureHandle handle = getHandle(location);
+  Slot &slot = slots[handle];
+  if (slot.loaded) {
+    unload(slot);
+  }
+  upload(slot, image, tiles);
+  slot.pinned = true;
+  return handle;
+}
+
+RenderLayer TextureManager::getLayer(TextureHandle handle) {
+  Slot &slot = slots[handle];
+  if (slot.classified) {
+    return slot.layer;
+  }
+
+  std::string path = getPath(slot.location);
+  Image image = LoadImage(path.c_str());
+  if (image.data != nullptr) {
+    ImageFormat(&image, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+    slot.layer =
+        classifyPixels(static_cast<const Color *>(image.data),
+                       static_cast<std::size_t>(image.width) * image.height);
+    UnloadImage(image);
+  }
+  slot.classified = true;
+  return slot.layer;
+}
+
+void TextureManager::load(Slot &slot) {
+  std::string path = getPath(slot.location);
+  Image image = LoadImage(path.c_str());
+  if (image.data == nullptr) {
+    // Missing textures stay unbound rather than being retried every frame
+    slot.texture = {};
+    slot.loaded = true;
+    return;
+  }
+  ImageFormat(&image, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+  upload(slot, image, {});
+  UnloadImage(image);
 }
+
+void TextureManager::upload(Slot &slot, const Image &image,
+                            const std::vector<MipTile> &tiles) {
+  auto start = std::chrono::steady_clock::now();
+  const Color *pixels = static_cast<const Color *>(image.data);
+  if (!slot.classified) {
+    slot.layer = classifyPixels(
+        pixels, static_cast<std::size_t>(image.width) * image.height);
+    slot.classified = true;
+  }
+
+  int levelCount =
+      mipmapped ? getMipLevelCount(image.width, image.height, tiles,
+                                   MAX_MIP_LEVELS)
+                : 0;
+  // Clut4 rows have to be whole bytes, so levels stop at two texels wide
+  while (levelCount > 0 && (image.width >> levelCount) < 2) {
+    --levelCount;
+  }
+  std::vector<MipLevel> mips =
+      buildMipChain(pixels, image.width, image.height, levelCount, tiles);
+
+  std::vector<UploadLevel> levels;
+  IndexedImage indexed;
+  bool useIndexed = false;
+  if (palettized) {
+    std::size_t count = static_cast<std::size_t>(image.width) * image.height;
+    std::vector<Color> palette = buildPalette(pixels, count, 256);
+    indexed = applyPalette(pixels, image.width, image.height, palette);
+    // Merging colours would visibly change the texture, and atlas pages
+    // holding many textures are the likeliest to need it, so those stay RGBA
+    useIndexed = indexed.exact;
+    if (useIndexed) {
+      ++stats.indexed;
+      levels.push_back({image.width, image.height, indexed.indices});
+      for (const MipLevel &mip : mips) {
+        levels.push_back(
+            {mip.width, mip.height,
+             applyPalette(mip.pixels.data(), mip.width, mip.height, palette)
+                 .indices});
+      }
+    } else {
+      ++stats.reduced;
+    }
+  }
+  if (!useIndexed) {
+    levels.push_back({image.width, image.height,
+                      toBytes(pixels, static_cast<std::size_t>(image.width) *
+                                          image.height)});
+    for (const MipLevel &mip : mips) {
+      levels.push_back({mip.width, mip.height,
+                        toBytes(mip.pixels.data(), mip.pixels.size())});
+    }
+  }
+
+  slot.bytes = 0;
+  for (const UploadLevel &level : levels) {
+    slot.bytes += level.data.size();
+  }
+  if (useIndexed) {
+    slot.bytes += indexed.palette.size() * sizeof(Color);
+  }
+
+  slot.texture = uploadLevels(levels, useIndexed ? &indexed : nullptr);
+  slot.rgbaBytes = GetPixelDataSize(image.width, image.height,
+                                    PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+  slot.loaded = true;
+  residentBytes += slot.bytes;
+  residentRgbaBytes += slot.rgbaBytes;
+
+  ++stats.converted;
+  stats.convertSeconds += std::chrono::duration<double>(
+                              std::chrono::steady_clock::now() - start)
+                              .count();
+}
+
+void TextureManager::unload(Slot &slot) {
+  UnloadTexture(slot.texture);
+  slot.texture = {};
+  slot.loaded = false;
+  residentBytes -= slot.bytes;
+  residentRgbaBytes -= slot.rgbaBytes;
+  slot.bytes = 0;
+  slot.rgbaBytes = 0;
+}
+
+void TextureManager::evictToBudget() {
+  while (residentBytes > budget) {
+    // Unreferenced textures go first, then the least recently drawn
+    Slot *victim = nullptr;
+    for (Slot &slot : slots) {
+      if (!slot.loaded || slot.pinned || slot.lastUsed == frame) {
+        continue;
+      }
+      if (victim == nullptr ||
+          (slot.refCount == 0) > (victim->refCount == 0) ||
+          ((slot.refCount == 0) == (victim->refCount == 0) &&
+           slot.lastUsed < victim->lastUsed)) {
+        victim = &slot;
+      }
+    }
+    if (victim == nullptr) {
+      return;
+    }
+    unload(*victim);
+    ++stats.evictions;
+  }
+}
+
+void TextureManager::setBudget(std::size_t bytes) {
+  budget = bytes;
+  evictToBudget();
+}
+
+} // namespace MCPSP
@@ -0,0 +1,212 @@
+#include "texture_quantizer.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace MCPSP {
+
+namespace {
+
+// Colours packed as RGBA bytes. Fully transparent pixels are all the same
+// colour as far as the alpha test is concerned.
+uint32_t pack(Color c) {
+  if (c.a == 0) {
+    return 0;
+  }
+  return c.r | c.g << 8 | c.b << 16 | static_cast<uint32_t>(c.a) << 24;
+}
+
+Color unpack(uint32_t v) {
+  return {static_cast<unsigned char>(v), static_cast<unsigned char>(v >> 8),
+          static_cast<unsigned char>(v >> 16),
+          static_cast<unsigned char>(v >> 24)};
+}
+
+int getChannel(uint32_t v, int channel) { return v >> (channel * 8) & 0xff; }
+
+struct Entry {
+  uint32_t color;
+  uint32_t count;
+};
+
+// A run of histogram entries that becomes one palette colour
+struct Box {
+  std::size_t begin;
+  std::size_t end;
+  // Channel with the widest spread, which is where the box gets split
+  int channel = 0;
+  int range = 0;
+};
+
+void measure(Box &box, const std::vector<Entry> &entries) {
+  box.range = 0;
+  for (int channel = 0; channel < 4; ++channel) {
+    int low = 255, high = 0;
+    for (std::size_t i = box.begin; i < box.end; ++i) {
+      int value = getChannel(entries[i].color, channel);
+      low = std::min(low, value);
+      high = std::max(high, value);
+    }
+    if (high - low > box.range) {
+      box.range = high - low;
+      box.channel = channel;
+    }
+  }
+}
+
+Color average(const Box &box, const std::vector<Entry> &entries) {
+  uint64_t sums[4] = {};
+  uint64_t total = 0;
+  for (std::size_t i = box.begin; i < box.end; ++i) {
+    for (int channel = 0; channel < 4; ++channel) {
+      sums[channel] +=
+          static_cast<uint64_t>(getChannel(entries[i].color, channel)) *
+          entries[i].count;
+    }
+    total += entries[i].count;
+  }
+  unsigned char channels[4];
+  for (int channel = 0; channel < 4; ++channel) {
+    channels[channel] =
+        static_cast<unsigned char>((sums[channel] + total / 2) / total);
+  }
+  return {channels[0], channels[1], channels[2], channels[3]};
+}
+
+int distance(uint32_t a, uint32_t b) {
+  int sum = 0;
+  for (int channel = 0; channel < 4; ++channel) {
+    int d = getChannel(a, channel) - getChannel(b, channel);
+    sum += d * d;
+  }
+  return sum;
+}
+
+} // namespace
+
+std::vector<Color> buildPalette(const Color *pixels, std::size_t count,
+                                int maxColors) {
+  std::unordered_map<uint32_t, uint32_t> histogram;
+  for (std::size_t i = 0; i < count; ++i) {
+    ++histogram[pack(pixels[i])];
+  }
+
+  // Sorted so the palette doesn't depend on hash map order
+  std::vector<Entry> entries;
+  entries.reserve(histogram.size());
+  for (const auto &[color, uses] : histogram) {
+    entries.push_back({color, uses});
+  }
+  std::sort(entries.begin(), entries.end(),
+            [](const Entry &a, const Entry &b) { return a.color < b.color; });
+
+  std::vector<Color> palette;
+  if (entries.size() <= static_cast<std::size_t>(maxColors)) {
+    for (const Entry &entry : entries) {
+      palette.push_back(unpack(entry.color));
+    }
+    return palette;
+  }
+
+  // Median cut: keep splitting the box with the widest channel at the median
+  // pixel until there is one box per palette entry
+  std::vector<Box> boxes = {{0, entries.size()}};
+  measure(boxes[0], entries);
+  while (boxes.size() < static_cast<std::size_t>(maxColors)) {
+    auto widest = std::max_element(
+        boxes.begin(), boxes.end(),
+        [](const Box &a, const Box &b) { return a.range < b.range; });
+    if (widest->range == 0) {
+      break;
+    }
+
+    Box box = *widest;
+    std::sort(entries.begin() + box.begin, entries.begin() + box.end,
+              [&](const Entry &a, const Entry &b) {
+                return getChannel(a.color, box.channel) <
+                       getChannel(b.color, box.channel);
+              });
+    uint64_t total = 0;
+    for (std::size_t i = box.begin; i < box.end; ++i) {
+      total += entries[i].count;
+    }
+    std::size_t split = box.begin + 1;
+    uint64_t seen = entries[box.begin].count;
+    while (split < box.end - 1 && seen * 2 < total) {
+      seen += entries[split++].count;
+    }
+
+    Box upper = {split, box.end};
+    widest->end = split;
+    measure(*widest, entries);
+    measure(upper, entries);
+    boxes.push_back(upper);
+  }
+
+  for (const Box &box : boxes) {
+    palette.push_back(average(box, entries));
+  }
+  return palette;
+}
+
+IndexedImage applyPalette(const Color *pixels, int width, int height,
+                          const std::vector<Color> &palette) {
+  if (palette.empty() || palette.size() > 256) {
+    throw std::runtime_error("palettes need between 1 and 256 colours");
+  }
+
+  IndexedImage image;
+  image.width = width;
+  image.height = height;
+  image.format = palette.size() <= 16 ? ClutFormat::Clut4 : ClutFormat::Clut8;
+  image.palette = palette;
+  image.palette.resize(image.format == ClutFormat::Clut4 ? 16 : 256,
+                       {0, 0, 0, 0});
+
+  std::vector<uint32_t> packed;
+  packed.reserve(palette.size());
+  for (Color color : palette) {
+    packed.push_back(pack(color));
+  }
+
+  std::size_t count = static_cast<std::size_t>(width) * height;
+  image.indices.assign(
+      image.format == ClutFormat::Clut4 ? (count + 1) / 2 : count, 0);
+
+  // Textures only use a handful of colours, so each is matched once
+  std::unordered_map<uint32_t, uint8_t> matches;
+  for (std::size_t i = 0; i < count; ++i) {
+    uint32_t color = pack(pixels[i]);
+    auto it = matches.find(color);
+    if (it == matches.end()) {
+      std::size_t best = 0;
+      int bestDistance = distance(color, packed[0]);
+      for (std::size_t j = 1; j < packed.size() && bestDistance > 0; ++j) {
+        int d = distance(color, packed[j]);
+        if (d < bestDistance) {
+          best = j;
+          bestDistance = d;
+        }
+      }
+      if (bestDistance > 0) {
+        image.exact = false;
+      }
+      it = matches.emplace(color, static_cast<uint8_t>(best)).first;
+    }
+
+    if (image.format == ClutFormat::Clut8) {
+      image.indices[i] = it->second;
+    } else {
+      image.indices[i / 2] |= it->second << (i % 2 * 4);
+    }
+  }
+  return image;
+}
+
+IndexedImage quantizeImage(const Color *pixels, int width, int height) {
+  std::size_t count = static_cast<std::size_t>(width) * height;
+  return applyPalette(pixels, width, height,
+                      buildPalette(pixels, count, 256));
+}
+
+} // namespace MCPSP
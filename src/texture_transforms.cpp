@@ -0,0 +1,102 @@
+#include "texture_transforms.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+namespace MCPSP {
+
+namespace {
+
+Color averageBox(const Color *pixels, int width, int x, int y) {
+  const Color texels[4] = {pixels[y * width + x], pixels[y * width + x + 1],
+                           pixels[(y + 1) * width + x],
+                           pixels[(y + 1) * width + x + 1]};
+  unsigned sums[3] = {};
+  unsigned alpha = 0;
+  for (const Color &texel : texels) {
+    sums[0] += texel.r * texel.a;
+    sums[1] += texel.g * texel.a;
+    sums[2] += texel.b * texel.a;
+    alpha += texel.a;
+  }
+  if (alpha == 0) {
+    return {0, 0, 0, 0};
+  }
+  return {static_cast<unsigned char>((sums[0] + alpha / 2) / alpha),
+          static_cast<unsigned char>((sums[1] + alpha / 2) / alpha),
+          static_cast<unsigned char>((sums[2] + alpha / 2) / alpha),
+          static_cast<unsigned char>((alpha + 2) / 4)};
+}
+
+// Copies the edge texels of a tile out into its padding.
+void extendPadding(Color *pixels, int width, int height, const MipTile &tile) {
+  for (int y = tile.y - tile.padding; y < tile.y + tile.height + tile.padding;
+       ++y) {
+    int sy = std::clamp(y, tile.y, tile.y + tile.height - 1);
+    for (int x = tile.x - tile.padding;
+         x < tile.x + tile.width + tile.padding; ++x) {
+      int sx = std::clamp(x, tile.x, tile.x + tile.width - 1);
+      if (x >= 0 && x < width && y >= 0 && y < height) {
+        pixels[y * width + x] = pixels[sy * width + sx];
+      }
+    }
+  }
+}
+
+} // namespace
+
+int getMipLevelCount(int width, int height, const std::vector<MipTile> &tiles,
+                     int maxLevels) {
+  int levels = 0;
+  while (levels < maxLevels) {
+    int scale = 2 << levels;
+    bool fits = width % scale == 0 && height % scale == 0;
+    for (const MipTile &tile : tiles) {
+      fits = fits && tile.x % scale == 0 && tile.y % scale == 0 &&
+             tile.width % scale == 0 && tile.height % scale == 0 &&
+             tile.padding % scale == 0;
+    }
+    if (!fits) {
+      break;
+    }
+    ++levels;
+  }
+  return levels;
+}
+
+std::vector<MipLevel> buildMipChain(const Color *pixels, int width, int height,
+                                    int levelCount,
+                                    const std::vector<MipTile> &tiles) {
+  std::vector<MipLevel> levels;
+  levels.reserve(levelCount);
+  const Color *source = pixels;
+  int sourceWidth = width;
+  for (int level = 1; level <= levelCount; ++level) {
+    MipLevel mip = {width >> level, height >> level, {}};
+    if (mip.width == 0 || mip.height == 0 || (width >> (level - 1)) % 2 != 0 ||
+        (height >> (level - 1)) % 2 != 0) {
+      throw std::runtime_error("image doesn't halve evenly into mip levels");
+    }
+    mip.pixels.resize(static_cast<std::size_t>(mip.width) * mip.height);
+    for (int y = 0; y < mip.height; ++y) {
+      for (int x = 0; x < mip.width; ++x) {
+        mip.pixels[y * mip.width + x] =
+            averageBox(source, sourceWidth, x * 2, y * 2);
+      }
+    }
+
+    // Boxes straddling a tile edge only land in the padding, which is then
+    // overwritten from the tile itself
+    for (const MipTile &tile : tiles) {
+      extendPadding(mip.pixels.data(), mip.width, mip.height,
+                    {tile.x >> level, tile.y >> level, tile.width >> level,
+                     tile.height >> level, tile.padding >> level});
+    }
+
+    levels.push_back(std::move(mip));
+    source = levels.back().pixels.data();
+    sourceWidth = levels.back().width;
+  }
+  return levels;
+}
+
+} // namespace MCPSP
@@ -0,0 +1,200 @@
+#include "tick_scheduler.hpp"
+#include <algorithm>
+
+namespace MCPSP {
+
+void TickScheduler::link(uint32_t index, uint32_t list) {
+  Entry &entry = entries[index];
+  List &target = lists[list];
+  entry.list = list;
+  entry.prev = target.tail;
+  entry.next = NONE;
+  if (target.tail != NONE) {
+    entries[target.tail].next = index;
+  } else {
+    target.head = index;
+  }
+  target.tail = index;
+  if (list == READY_LIST) {
+    ++readyCount;
+  }
+}
+
+void TickScheduler::unlink(uint32_t index) {
+  Entry &entry = entries[index];
+  List &source = lists[entry.list];
+  if (entry.prev != NONE) {
+    entries[entry.prev].next = entry.next;
+  } else {
+    source.head = entry.next;
+  }
+  if (entry.next != NONE) {
+    entries[entry.next].prev = entry.prev;
+  } else {
+    source.tail = entry.prev;
+  }
+  if (entry.list == READY_LIST) {
+    --readyCount;
+  }
+  entry.list = NONE;
+}
+
+void TickScheduler::release(uint32_t index) {
+  unlink(index);
+
+  Entry &entry = entries[index];
+  if (entry.chunkPrev != NONE) {
+    entries[entry.chunkPrev].chunkNext = entry.chunkNext;
+  } else {
+    auto it = chunkHeads.find(entry.tick.chunk);
+    if (entry.chunkNext == NONE) {
+      chunkHeads.erase(it);
+    } else {
+      it->second = entry.chunkNext;
+    }
+  }
+  if (entry.chunkNext != NONE) {
+    entries[entry.chunkNext].chunkPrev = entry.chunkPrev;
+  }
+
+  // Handles to the entry no longer match once it is reused
+  ++entry.generation;
+  entry.next = freeHead;
+  freeHead = index;
+  --scheduledCount;
+}
+
+void TickScheduler::place(uint32_t index) {
+  uint64_t due = entries[index].due;
+  if (due <= currentTick) {
+    link(index, READY_LIST);
+    return;
+  }
+
+  // The lowest level whose slots above it agree with the current tick is the
+  // one that reaches the due tick before wrapping around
+  for (int level = 0; level < LEVEL_COUNT; ++level) {
+    int shift = SLOT_BITS * (level + 1);
+    if (due >> shift == currentTick >> shift) {
+      uint32_t slot = due >> (SLOT_BITS * level) & (SLOT_COUNT - 1);
+      link(index, level * SLOT_COUNT + slot);
+      return;
+    }
+  }
+  link(index, OVERFLOW_LIST);
+}
+
+void TickScheduler::cascade(uint32_t list) {
+  uint32_t index = lists[list].head;
+  lists[list] = List();
+  while (index != NONE) {
+    uint32_t next = entries[index].next;
+    place(index);
+    index = next;
+  }
+}
+
+TickHandle TickScheduler::schedule(const ScheduledTick &tick, uint32_t delay) {
+  uint32_t index = freeHead;
+  if (index != NONE) {
+    freeHead = entries[index].next;
+  } else {
+    index = static_cast<uint32_t>(entries.size());
+    entries.emplace_back();
+  }
+
+  Entry &entry = entries[index];
+  entry.tick = tick;
+  entry.due = currentTick + delay;
+
+  uint32_t &chunkHead = chunkHeads.try_emplace(tick.chunk, NONE).first->second;
+  entry.chunkPrev = NONE;
+  entry.chunkNext = chunkHead;
+  if (chunkHead != NONE) {
+    entries[chunkHead].chunkPrev = index;
+  }
+  chunkHead = index;
+
+  place(index);
+  ++scheduledCount;
+  return {index, entry.generation};
+}
+
+bool TickScheduler::cancel(TickHandle handle) {
+  if (handle.index >= entries.size() ||
+      entries[handle.index].generation != handle.generation ||
+      entries[handle.index].list == NONE) {
+    return false;
+  }
+  release(handle.index);
+  return true;
+}
+
+void TickScheduler::advance() {
+  ++currentTick;
+
+  // Spread the slots that start at this tick down a level, highest level
+  // first so that their ticks carry on down to level 0
+  for (int level = LEVEL_COUNT; level >= 1; --level) {
+    uint64_t span = (uint64_t(1) << (SLOT_BITS * level)) - 1;
+    if ((currentTick & span) != 0) {
+      continue;
+    }
+    if (level == LEVEL_COUNT) {
+      cascade(OVERFLOW_LIST);
+    } else {
+      uint32_t slot = currentTick >> (SLOT_BITS * level) & (SLOT_COUNT - 1);
+      cascade(level * SLOT_COUNT + slot);
+    }
+  }
+
+  // Everything in the level 0 slot is due now
+  cascade(currentTick & (SLOT_COUNT - 1));
+}
+
+void TickScheduler::takeReady(std::vector<ScheduledTick> &out, int budget) {
+  std::size_t start = out.size();
+  for (; budget > 0 && lists[READY_LIST].head != NONE; --budget) {
+    uint32_t index = lists[READY_LIST].head;
+    out.push_back(entries[index].tick);
+    release(index);
+  }
+
+  // Stable, so each chunk's ticks keep running in the order they came due
+  std::stable_sort(out.begin() + start, out.end(),
+                   [](const ScheduledTick &a, const ScheduledTick &b) {
+                     return a.chunk.x != b.chunk.x ? a.chunk.x < b.chunk.x
+                                                   : a.chunk.z < b.chunk.z;
+                   });
+}
+
+void TickScheduler::getChunkTicks(const ChunkPosition &chunk,
+                                  std::vector<SavedTick> &out) const {
+  auto it = chunkHeads.find(chunk);
+  if (it == chunkHeads.end()) {
+    return;
+  }
+  for (uint32_t index = it->second; index != NONE;
+       index = entries[index].chunkNext) {
+    const Entry &entry = entries[index];
+    uint64_t delay = entry.due > currentTick ? entry.due - currentTick : 0;
+    delay = std::min<uint64_t>(delay, UINT32_MAX);
+    out.push_back({entry.tick.index, entry.tick.block,
+                   static_cast<uint32_t>(delay)});
+  }
+}
+
+void TickScheduler::removeChunk(const ChunkPosition &chunk) {
+  auto it = chunkHeads.find(chunk);
+  if (it == chunkHeads.end()) {
+    return;
+  }
+  uint32_t index = it->second;
+  while (index != NONE) {
+    uint32_t next = entries[index].chunkNext;
+    release(index);
+    index = next;
+  }
+}
+
+} // namespace MCPSP
@@ -1,33 +1,442 @@
 #include "world.hpp"
+#include "block_registry.hpp"
 #include "chunk.hpp"
+#include "frustum.hpp"
+#include "raylib.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <vector>
 
 namespace MCPSP {
 
 void World::generateChunk(int x, int z) {
   ChunkPosition pos{x, z};
 
-  if (chunks.find(pos) == chunks.end()) {
-    chunks[pos] = Chunk(this, x, z);
+  // Start from a fresh chunk, so that it is entirely air
+  chunks[pos] = Chunk(this, x, z);
+  generator.generate(chunks[pos]);
+  lightEngine.initChunk(chunks[pos]);
+
+  // Border faces culled against nothing can now be culled against this chunk
+  markNeighborsDirty(x, z);
+}
+
+void World::markNeighborsDirty(int x, int z) {
+  static const int neighbors[4][2] = {{-1, 0}, {1, 0}, {0, -1}, {0, 1}};
+  for (const auto &offset : neighbors) {
+    if (Chunk *neighbor = getChunk(x + offset[0], z + offset[1])) {
+      neighbor->markDirty();
+    }
+  }
+}
+
+bool World::loadChunk(int x, int z) {
+  ChunkPosition pos{x, z};
+  Chunk chunk(this, x, z);
+  try {
+    if (!storage.loadChunk(chunk)) {
+      return false;
+    }
+  } catch (const std::exception &e) {
+    std::cout << "Failed to load chunk " << x << ", " << z << ": " << e.what()
+              << std::endl;
+    return false;
+  }
+
+  // Light isn't saved, so it is worked out again on every load
+  chunks[pos] = std::move(chunk);
+  lightEngine.initChunk(chunks[pos]);
+  markNeighborsDirty(x, z);
+  return true;
+}
+
+void World::unloadChunk(int x, int z) {
+  auto it = chunks.find({x, z});
+  if (it == chunks.end()) {
+    return;
+  }
+  if (it->second.isModified()) {
+    storage.saveChunk(it->second);
+  }
+  // The chunk's ticks are saved with it
+  ticks.removeChunk({x, z});
+  it->second.releaseMeshes();
+  lightEngine.unloadChunk(it->second);
+  chunks.erase(it);
+
+  // Faces that were culled against the chunk are visible again. Meshes still
+  // being built for it are dropped when they come back.
+  markNeighborsDirty(x, z);
+}
+
+void World::save() {
+  for (auto &[pos, chunk] : chunks) {
+    if (chunk.isModified()) {
+      storage.saveChunk(chunk);
+      chunk.clearModified();
+    }
+  }
+}
+
+void World::update(const Vector3 &focus) {
+  // Started lazily, as threads can't be created before main() on the PSP
+  meshWorker.start();
+
+  MeshResult result;
+  for (int uploaded = 0;
+       uploaded < meshUploadBudget && meshWorker.poll(result);) {
+    if (Chunk *chunk = getChunk(result.position.x, result.position.z)) {
+      if (chunk->applyMesh(result)) {
+        ++uploaded;
+      }
+    }
+  }
+
+  // Mesh the chunks nearest the focus first, as those are the most likely
+  // to be on screen
+  std::vector<std::pair<float, Chunk *>> pending;
+  for (auto &[pos, chunk] : chunks) {
+    if (chunk.needsMeshing()) {
+      float dx = pos.x * 16 + 8 - focus.x;
+      float dz = pos.z * 16 + 8 - focus.z;
+      pending.push_back({dx * dx + dz * dz, &chunk});
+    }
+  }
+  std::sort(pending.begin(), pending.end(),
+            [](const auto &a, const auto &b) { return a.first < b.first; });
+
+  int budget = meshQueueBudget;
+  for (auto &[distance, chunk] : pending) {
+    if (budget <= 0) {
+      break;
+    }
+    chunk->queueMeshing(meshWorker, nextMeshTicket, budget);
+  }
+}
+
+void World::tick() {
+  ticks.advance();
+  dueTicks.clear();
+  ticks.takeReady(dueTicks, tickBudget);
+
+  // Ticks come grouped by chunk, so the chunk is only looked up when the
+  // group changes
+  ticksRun = 0;
+  Chunk *chunk = nullptr;
+  for (const ScheduledTick &tick : dueTicks) {
+    if (chunk == nullptr || chunk->getChunkX() != tick.chunk.x ||
+        chunk->getChunkZ() != tick.chunk.z) {
+      chunk = getChunk(tick.chunk.x, tick.chunk.z);
+      if (chunk == nullptr) {
+        continue;
+      }
+    }
+
+    int x = tick.getX();
+    int y = tick.getY();
+    int z = tick.getZ();
+    // The block may have been replaced since the tick was scheduled
+    if (chunk->getBlock(x, y, z).block != tick.block) {
+      continue;
+    }
+    if (BlockTickCallback callback =
+            BlockRegistry::getBlock(tick.block).onScheduledTick) {
+      callback(*this, *chunk, x, y, z);
+      ++ticksRun;
+    }
+  }
+}
+
+TickHandle World::scheduleTick(int x, int y, int z, uint32_t delay) {
+  Chunk *chunk = getChunk(x >> 4, z >> 4);
+  if (chunk == nullptr || y < 0 || y >= Chunk::HEIGHT) {
+    return {};
+  }
+  chunk->markModified();
+  ResourceLocation block = chunk->getBlock(x & 15, y, z & 15).block;
+  return ticks.schedule(
+      {{x >> 4, z >> 4}, ScheduledTick::packIndex(x & 15, y, z & 15), block},
+      delay);
+}
+
+static int floorDiv(float value, int divisor) {
+  return static_cast<int>(std::floor(value / divisor));
+}
+
+// Intersects a ray with a box using the slab method. On a hit, sets distance
+// to where the ray enters the box (0 if it starts inside) and axis to the
+// axis of the side it enters through (-1 if it starts inside).
+static bool intersectBox(const float origin[3], const float direction[3],
+                         const float min[3], const float max[3],
+                         float &distance, int &axis) {
+  float enter = -INFINITY;
+  float leave = INFINITY;
+  int enterAxis = -1;
+  for (int a = 0; a < 3; ++a) {
+    if (direction[a] == 0.0f) {
+      if (origin[a] < min[a] || origin[a] > max[a]) {
+        return false;
+      }
+      continue;
+    }
+    float t1 = (min[a] - origin[a]) / direction[a];
+    float t2 = (max[a] - origin[a]) / direction[a];
+    if (t1 > t2) {
+      std::swap(t1, t2);
+    }
+    if (t1 > enter) {
+      enter = t1;
+      enterAxis = a;
+    }
+    leave = std::min(leave, t2);
+  }
+  if (enter > leave || leave < 0.0f) {
+    return false;
+  }
+  distance = std::max(enter, 0.0f);
+  axis = enter > 0.0f ? enterAxis : -1;
+  return true;
+}
+
+RaycastHit World::raycast(const Vector3 &origin, const Vector3 &direction,
+                          float maxDistance) const {
+  RaycastHit result;
+  float length = std::sqrt(direction.x * direction.x +
+                           direction.y * direction.y +
+                           direction.z * direction.z);
+  if (length == 0.0f) {
+    return result;
+  }
+  const float start[3] = {origin.x, origin.y, origin.z};
+  const float dir[3] = {direction.x / length, direction.y / length,
+                        direction.z / length};
+
+  // Amanatides-Woo traversal: step into whichever neighbouring block the ray
+  // reaches first. next[a] is the distance at which the ray crosses into the
+  // next block along axis a, and delta[a] the distance between crossings.
+  int block[3];
+  int step[3];
+  float next[3];
+  float delta[3];
+  for (int a = 0; a < 3; ++a) {
+    block[a] = static_cast<int>(std::floor(start[a]));
+    step[a] = dir[a] > 0.0f ? 1 : (dir[a] < 0.0f ? -1 : 0);
+    delta[a] = step[a] != 0 ? 1.0f / std::fabs(dir[a]) : INFINITY;
+    if (step[a] > 0) {
+      next[a] = (block[a] + 1 - start[a]) * delta[a];
+    } else if (step[a] < 0) {
+      next[a] = (start[a] - block[a]) * delta[a];
+    } else {
+      next[a] = INFINITY;
+    }
   }
 
-  Chunk &chunk = chunks[pos];
+  static const Direction negativeFaces[3] = {Direction::West, Direction::Down,
+                                             Direction::North};
+  static const Direction positiveFaces[3] = {Direction::East, Direction::Up,
+                                             Direction::South};
+
+  // Consecutive blocks are almost always in the same chunk, so it is only
+  // looked up again when the ray crosses into another one
+  const Chunk *chunk = nullptr;
+  int chunkX = 0;
+  int chunkZ = 0;
+  bool chunkKnown = false;
 
-  // TODO: More advanced terrain generation
-  for (int i = 0; i < 16; ++i) {
-    for (int j = 0; j < 64; ++j) {
-      for (int k = 0; k < 16; ++k) {
-        if (j == 0) {
-          chunk.setBlock(i, j, k, ResourceLocation("minecraft:bedrock"));
-        } else if (j < 10) {
-          chunk.setBlock(i, j, k, ResourceLocation("minecraft:dirt"));
-        } else if (j < 11) {
-          chunk.setBlock(i, j, k, ResourceLocation("minecraft:grass_block"));
-        } else {
-          chunk.setBlock(i, j, k, ResourceLocation("minecraft:air"));
+  float distance = 0.0f;
+  int enteredAxis = -1;
+  while (distance <= maxDistance) {
+    int cx = block[0] >> 4;
+    int cz = block[2] >> 4;
+    if (!chunkKnown || cx != chunkX || cz != chunkZ) {
+      chunk = getChunk(cx, cz);
+      chunkX = cx;
+      chunkZ = cz;
+      chunkKnown = true;
+    }
+
+    int localX = block[0] & 15;
+    int localZ = block[2] & 15;
+    if (chunk != nullptr && block[1] >= 0 && block[1] < Chunk::HEIGHT &&
+        !chunk->isAir(localX, block[1], localZ)) {
+      BlockState state = chunk->getBlock(localX, block[1], localZ);
+      const BakedModel &model =
+          BlockRegistry::getBlock(state.block).bakedModel;
+
+      float hitDistance = INFINITY;
+      int hitAxis = -1;
+      if (model.isOpaque()) {
+        // Full cubes are hit where the ray enters their block
+        hitDistance = distance;
+        hitAxis = enteredAxis;
+      } else {
+        for (const BoundingBox &box : model.getBoxes()) {
+          const float min[3] = {block[0] + box.min.x, block[1] + box.min.y,
+                                block[2] + box.min.z};
+          const float max[3] = {block[0] + box.max.x, block[1] + box.max.y,
+                                block[2] + box.max.z};
+          float boxDistance;
+          int boxAxis;
+          if (intersectBox(start, dir, min, max, boxDistance, boxAxis) &&
+              boxDistance < hitDistance) {
+            hitDistance = boxDistance;
+            hitAxis = boxAxis;
+          }
+        }
+      }
+
+      if (hitDistance <= maxDistance) {
+        result.hit = true;
+        result.x = block[0];
+        result.y = block[1];
+        result.z = block[2];
+        result.block = state;
+        if (hitAxis >= 0) {
+          result.face = step[hitAxis] > 0 ? negativeFaces[hitAxis]
+                                          : positiveFaces[hitAxis];
         }
+        result.position = {start[0] + dir[0] * hitDistance,
+                           start[1] + dir[1] * hitDistance,
+                           start[2] + dir[2] * hitDistance};
+        result.distance = hitDistance;
+        return result;
+      }
+    }
+
+    int axis = next[0] < next[1] ? (next[0] < next[2] ? 0 : 2)
+                                 : (next[1] < next[2] ? 1 : 2);
+    distance = next[axis];
+    next[axis] += delta[axis];
+    block[axis] += step[axis];
+    enteredAxis = axis;
+  }
+  return result;
+}
+
+bool World::findReachableSections(const Camera3D &camera,
+                                  const Frustum &frustum) {
+  struct Step {
+    ChunkPosition position;
+    int sectionY;
+    // Face the section was entered through, None for the starting section
+    Direction from;
+    // Directions taken so far. The walk never turns back on itself, which
+    // keeps it from wandering around corners the camera can't see past.
+    uint8_t directions;
+  };
+
+  reachableSections.clear();
+  std::vector<Step> queue;
+
+  ChunkPosition cameraChunk{floorDiv(camera.position.x, 16),
+                            floorDiv(camera.position.z, 16)};
+  int cameraSection = floorDiv(camera.position.y, ChunkSection::SIZE);
+
+  if (cameraSection >= 0 && cameraSection < Chunk::SECTION_COUNT) {
+    if (!hasChunk(cameraChunk.x, cameraChunk.z)) {
+      return false;
+    }
+    queue.push_back({cameraChunk, cameraSection, Direction::None, 0});
+    reachableSections[cameraChunk] |= 1u << cameraSection;
+  } else {
+    // Above or below the world, everything on the nearest layer can be seen
+    bool above = cameraSection >= Chunk::SECTION_COUNT;
+    int sectionY = above ? Chunk::SECTION_COUNT - 1 : 0;
+    for (const auto &[pos, chunk] : chunks) {
+      Vector3 min = {static_cast<float>(pos.x * 16),
+                     static_cast<float>(sectionY * ChunkSection::SIZE),
+                     static_cast<float>(pos.z * 16)};
+      Vector3 max = {min.x + 16.0f, min.y + ChunkSection::SIZE, min.z + 16.0f};
+      if (frustum.isBoxVisible(min, max)) {
+        queue.push_back(
+            {pos, sectionY, above ? Direction::Up : Direction::Down, 0});
+        reachableSections[pos] |= 1u << sectionY;
+      }
+    }
+  }
+
+  for (std::size_t head = 0; head < queue.size(); ++head) {
+    Step step = queue[head];
+    const SectionVisibility &visibility =
+        getChunk(step.position.x, step.position.z)
+            ->getSection(step.sectionY)
+            .visibility;
+
+    for (int face = 0; face < 6; ++face) {
+      Direction direction = static_cast<Direction>(face);
+      Direction opposite = getOpposite(direction);
+      if (step.directions & (1 << static_cast<int>(opposite))) {
+        continue;
+      }
+      if (step.from != Direction::None &&
+          !visibility.isConnected(step.from, direction)) {
+        continue;
+      }
+
+      DirectionOffset offset = getOffset(direction);
+      ChunkPosition position{step.position.x + offset.x,
+                             step.position.z + offset.z};
+      int sectionY = step.sectionY + offset.y;
+      if (sectionY < 0 || sectionY >= Chunk::SECTION_COUNT ||
+          !hasChunk(position.x, position.z)) {
+        continue;
       }
+
+      uint32_t &reachable = reachableSections[position];
+      if (reachable & (1u << sectionY)) {
+        continue;
+      }
+      Vector3 min = {static_cast<float>(position.x * 16),
+                     static_cast<float>(sectionY * ChunkSection::SIZE),
+                     static_cast<float>(position.z * 16)};
+      Vector3 max = {min.x + 16.0f, min.y + ChunkSection::SIZE, min.z + 16.0f};
+      if (!frustum.isBoxVisible(min, max)) {
+        continue;
+      }
+
+      reachable |= 1u << sectionY;
+      queue.push_back({position, sectionY, opposite,
+                       static_cast<uint8_t>(step.directions | (1 << face))});
+    }
+  }
+  return true;
+}
+
+void World::draw(const Camera3D &camera) {
+  drawStats = DrawStats();
+  renderList.clear();
+  Frustum frustum(camera, static_cast<float>(GetScreenWidth()) /
+                              static_cast<float>(GetScreenHeight()));
+  bool occlusion = findReachableSections(camera, frustum);
+
+  for (auto &[pos, chunk] : chunks) {
+    Vector3 position = {static_cast<float>(pos.x * 16), 0.0f,
+                        static_cast<float>(pos.z * 16)};
+    Vector3 max = {position.x + 16.0f, static_cast<float>(Chunk::HEIGHT),
+                   position.z + 16.0f};
+    if (!frustum.isBoxVisible(position, max)) {
+      ++drawStats.chunksCulled;
+      drawStats.trianglesCulled += chunk.getVertexCount() / 2;
+      continue;
     }
+    ++drawStats.chunksDrawn;
+
+    uint32_t reachable = ~0u;
+    if (occlusion) {
+      auto it = reachableSections.find(pos);
+      reachable = it != reachableSections.end() ? it->second : 0;
+    }
+    chunk.queueDraws(position, frustum, reachable, camera.position,
+                     renderList, drawStats);
   }
+
+  renderList.sort(drawOrder);
+  GLRenderBackend backend;
+  RenderList::SubmitStats submitted = renderList.submit(backend);
+  drawStats.drawCalls = submitted.drawCalls;
+  drawStats.textureBinds = submitted.textureBinds;
+  drawStats.stateChanges = submitted.stateChanges;
 }
 
 } // namespace MCPSP
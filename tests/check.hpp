@@ -0,0 +1,45 @@
+#pragma once
+#include <exception>
+#include <iostream>
+
+// Minimal checks for the host tests. A failed check is reported and counted
+// rather than aborting, so one run shows every failure.
+namespace MCPSP::Test {
+
+inline int failures = 0;
+
+inline void fail(const char *file, int line, const char *message) {
+  ++failures;
+  std::cout << file << ":" << line << ": " << message << std::endl;
+}
+
+// Exit code for main()
+inline int report() {
+  if (failures != 0) {
+    std::cout << failures << " checks failed" << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+} // namespace MCPSP::Test
+
+#define CHECK(condition)                                                      \
+  do {                                                                        \
+    if (!(condition)) {                                                       \
+      MCPSP::Test::fail(__FILE__, __LINE__, "CHECK(" #condition ") failed");  \
+    }                                                                         \
+  } while (0)
+
+#define CHECK_THROWS(expression)                                              \
+  do {                                                                        \
+    bool thrown = false;                                                      \
+    try {                                                                     \
+      expression;                                                             \
+    } catch (const std::exception &) {                                        \
+      thrown = true;                                                          \
+    }                                                                         \
+    if (!thrown) {                                                            \
+      MCPSP::Test::fail(__FILE__, __LINE__, #expression " didn't throw");     \
+    }                                                                         \
+  } while (0)
@@ -0,0 +1,270 @@
+// Saves chunks through region files and reads them back, checking that
+// every block and scheduled tick survives and that damaged records throw.
+#include "block_registry.hpp"
+#include "byte_buffer.hpp"
+#include "check.hpp"
+#include "chunk.hpp"
+#include "region_file.hpp"
+#include "world.hpp"
+#include <cstdio>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace MCPSP;
+
+static const std::filesystem::path directory =
+    std::filesystem::temp_directory_path() / "mcpsp_chunk_storage_test";
+
+static BlockState testBlock(int i) {
+  return {ResourceLocation("test:block_" + std::to_string(i))};
+}
+
+// Gives each section a different palette size: one block, two blocks and
+// air, a few dozen blocks, and more blocks than fit in a byte.
+static void fillChunk(Chunk &chunk, unsigned seed) {
+  static const int paletteSizes[Chunk::SECTION_COUNT] = {1, 3, 40, 300};
+  std::mt19937 random(seed);
+  for (int y = 0; y < Chunk::HEIGHT; ++y) {
+    int paletteSize = paletteSizes[y / ChunkSection::SIZE];
+    for (int z = 0; z < 16; ++z) {
+      for (int x = 0; x < 16; ++x) {
+        int i = paletteSize == 1 ? 0 : random() % paletteSize;
+        // Index 0 is air, except in the single block section
+        if (paletteSize == 1 || i != 0) {
+          chunk.setGeneratedBlock(x, y, z, testBlock(i));
+        }
+      }
+    }
+  }
+}
+
+static bool sameBlocks(const Chunk &a, const Chunk &b) {
+  for (int y = 0; y < Chunk::HEIGHT; ++y) {
+    for (int z = 0; z < 16; ++z) {
+      for (int x = 0; x < 16; ++x) {
+        if (!(a.getBlock(x, y, z) == b.getBlock(x, y, z))) {
+          return false;
+        }
+      }
+    }
+  }
+  return true;
+}
+
+static std::vector<uint8_t> writeChunk(const Chunk &chunk) {
+  std::vector<uint8_t> data;
+  ByteWriter out(data);
+  chunk.write(out);
+  return data;
+}
+
+static void readChunk(Chunk &chunk, const std::vector<uint8_t> &data) {
+  ByteReader in(data.data(), data.size());
+  chunk.read(in);
+}
+
+// A chunk as saved before scheduled ticks were, with only its sections
+static std::vector<uint8_t> writePreTickChunk(const Chunk &chunk) {
+  std::vector<uint8_t> data;
+  ByteWriter out(data);
+  out.u8(Chunk::SECTION_COUNT);
+  for (int sectionY = 0; sectionY < Chunk::SECTION_COUNT; ++sectionY) {
+    chunk.getSection(sectionY).write(out);
+  }
+  return data;
+}
+
+static void testRegionRoundTrip() {
+  std::string path = (directory / "round_trip.mcpr").string();
+  std::vector<Chunk> chunks;
+  for (int i = 0; i < 4; ++i) {
+    chunks.emplace_back(nullptr, i * 5, 15 - i * 3);
+    fillChunk(chunks.back(), i);
+  }
+
+  {
+    std::unique_ptr<RegionFile> region = RegionFile::open(path, true);
+    for (const Chunk &chunk : chunks) {
+      region->write(chunk.getChunkX(), chunk.getChunkZ(), writeChunk(chunk));
+    }
+    // Smaller chunks are rewritten in place, bigger ones appended
+    Chunk smaller(nullptr, 0, 15);
+    smaller.setGeneratedBlock(1, 2, 3, testBlock(7));
+    region->write(0, 15, writeChunk(smaller));
+    region->write(0, 15, writeChunk(chunks[0]));
+  }
+
+  std::unique_ptr<RegionFile> region = RegionFile::open(path, false);
+  CHECK(region != nullptr);
+  for (const Chunk &chunk : chunks) {
+    RegionFile::Record record;
+    CHECK(region->read(chunk.getChunkX(), chunk.getChunkZ(), record));
+    Chunk loaded(nullptr, chunk.getChunkX(), chunk.getChunkZ());
+    ByteReader in(record.data, record.size);
+    loaded.read(in);
+    CHECK(sameBlocks(chunk, loaded));
+  }
+
+  RegionFile::Record record;
+  CHECK(!region->read(1, 1, record));
+  CHECK(RegionFile::open((directory / "missing.mcpr").string(), false) ==
+        nullptr);
+}
+
+static void testDamagedRecords() {
+  Chunk chunk(nullptr, 0, 0);
+  fillChunk(chunk, 10);
+  std::vector<uint8_t> data = writeChunk(chunk);
+
+  // Cut short anywhere but where the sections end, which is a valid
+  // pre-tick record
+  for (std::size_t size : {std::size_t(0), std::size_t(1), data.size() / 2,
+                           data.size() - 3, data.size() - 1}) {
+    std::vector<uint8_t> truncated(data.begin(), data.begin() + size);
+    Chunk loaded(nullptr, 0, 0);
+    CHECK_THROWS(readChunk(loaded, truncated));
+  }
+
+  std::vector<uint8_t> corrupt = data;
+  corrupt[0] = Chunk::SECTION_COUNT + 1;
+  Chunk wrongSectionCount(nullptr, 0, 0);
+  CHECK_THROWS(readChunk(wrongSectionCount, corrupt));
+
+  corrupt = data;
+  corrupt.push_back(0);
+  Chunk trailingData(nullptr, 0, 0);
+  CHECK_THROWS(readChunk(trailingData, corrupt));
+
+  // A run pointing past the palette, and runs covering too many blocks
+  for (uint16_t runLength : {uint16_t(ChunkSection::VOLUME), uint16_t(4097)}) {
+    std::vector<uint8_t> record;
+    ByteWriter out(record);
+    out.u8(Chunk::SECTION_COUNT);
+    out.u16(1);
+    out.string("test:block_0");
+    out.u16(1);
+    out.u16(runLength);
+    out.u16(runLength == ChunkSection::VOLUME ? 1 : 0);
+    Chunk malformed(nullptr, 0, 0);
+    CHECK_THROWS(readChunk(malformed, record));
+  }
+
+  // A tick outside the chunk
+  corrupt = writePreTickChunk(chunk);
+  ByteWriter out(corrupt);
+  out.u32(1);
+  out.u16(16 * Chunk::HEIGHT * 16);
+  out.u32(1);
+  out.string("test:block_0");
+  Chunk tickOutside(nullptr, 0, 0);
+  CHECK_THROWS(readChunk(tickOutside, corrupt));
+
+  // A header entry reaching past the end of the file
+  std::string path = (directory / "corrupt.mcpr").string();
+  RegionFile::open(path, true)->write(2, 0, data);
+  std::FILE *file = std::fopen(path.c_str(), "r+b");
+  std::fseek(file, 8 + 2 * 2 * sizeof(uint32_t) + sizeof(uint32_t), SEEK_SET);
+  const uint8_t length[4] = {0xff, 0xff, 0xff, 0x0f};
+  std::fwrite(length, 1, sizeof(length), file);
+  std::fclose(file);
+  RegionFile::Record record;
+  CHECK_THROWS(RegionFile::open(path, false)->read(2, 0, record));
+
+  std::string notRegion = (directory / "not_region.mcpr").string();
+  file = std::fopen(notRegion.c_str(), "wb");
+  std::fputs("not a region file", file);
+  std::fclose(file);
+  CHECK_THROWS(RegionFile::open(notRegion, false));
+}
+
+static std::vector<ScheduledTick> ticksRun;
+
+static void recordTick(World &world, Chunk &chunk, int x, int y, int z) {
+  ticksRun.push_back({{chunk.getChunkX(), chunk.getChunkZ()},
+                      ScheduledTick::packIndex(x, y, z),
+                      chunk.getBlock(x, y, z).block});
+}
+
+static void testTickRoundTrip() {
+  ResourceLocation ticking("test:ticking");
+  Block block;
+  block.onScheduledTick = recordTick;
+  BlockRegistry::registerBlock(ticking, block);
+
+  World world;
+  world.setSaveDirectory((directory / "ticks").string());
+  world.generateChunk(0, 0);
+  world.generateChunk(1, 0);
+  world.getChunk(0, 0)->setBlock(3, 60, 4, ticking);
+  world.getChunk(1, 0)->setBlock(2, 60, 2, ticking);
+  world.scheduleTick(3, 60, 4, 5);
+  // Far enough ahead to wait in a higher level of the wheel
+  world.scheduleTick(3, 60, 4, 500);
+  world.scheduleTick(16 + 2, 60, 2, 9);
+  world.tick();
+  world.tick();
+
+  // Only the other chunk's tick is left while this one is unloaded, and the
+  // saved ones keep their remaining delay however long that is
+  world.unloadChunk(0, 0);
+  CHECK(world.getTickScheduler().getScheduledCount() == 1);
+  world.tick();
+  world.tick();
+  CHECK(world.loadChunk(0, 0));
+  CHECK(world.getTickScheduler().getScheduledCount() == 3);
+
+  std::vector<TickScheduler::SavedTick> saved;
+  world.getTickScheduler().getChunkTicks({0, 0}, saved);
+  CHECK(saved.size() == 2);
+  for (const TickScheduler::SavedTick &tick : saved) {
+    CHECK(tick.index == ScheduledTick::packIndex(3, 60, 4));
+    CHECK(tick.block == ticking);
+    CHECK(tick.delay == 3 || tick.delay == 498);
+  }
+
+  world.tick();
+  world.tick();
+  CHECK(ticksRun.empty());
+  world.tick();
+  CHECK(ticksRun.size() == 1);
+  CHECK(ticksRun.back().chunk == (ChunkPosition{0, 0}));
+  world.tick();
+  world.tick();
+  CHECK(ticksRun.size() == 2);
+  CHECK(ticksRun.back().chunk == (ChunkPosition{1, 0}));
+}
+
+static void testPreTickRecord() {
+  Chunk chunk(nullptr, 2, 3);
+  fillChunk(chunk, 20);
+  std::vector<uint8_t> data = writePreTickChunk(chunk);
+
+  Chunk loaded(nullptr, 2, 3);
+  readChunk(loaded, data);
+  CHECK(sameBlocks(chunk, loaded));
+
+  // Through a world, which schedules nothing for it
+  std::filesystem::create_directories(directory / "pre_tick");
+  RegionFile::open((directory / "pre_tick" / "r.0.0.mcpr").string(), true)
+      ->write(2, 3, data);
+  World world;
+  world.setSaveDirectory((directory / "pre_tick").string());
+  CHECK(world.loadChunk(2, 3));
+  CHECK(sameBlocks(chunk, *world.getChunk(2, 3)));
+  CHECK(world.getTickScheduler().getScheduledCount() == 0);
+}
+
+int main() {
+  std::filesystem::remove_all(directory);
+  std::filesystem::create_directories(directory);
+
+  testRegionRoundTrip();
+  testDamagedRecords();
+  testTickRoundTrip();
+  testPreTickRecord();
+
+  std::filesystem::remove_all(directory);
+  return MCPSP::Test::report();
+}
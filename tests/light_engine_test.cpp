@@ -0,0 +1,244 @@
+// Edits blocks around light sources and compares the light the engine
+// keeps up to date with flooding the whole world again from scratch.
+#include "block_registry.hpp"
+#include "check.hpp"
+#include "mesh_worker.hpp"
+#include "world.hpp"
+#include <array>
+#include <deque>
+#include <filesystem>
+#include <random>
+#include <vector>
+
+using namespace MCPSP;
+
+static const std::filesystem::path directory =
+    std::filesystem::temp_directory_path() / "mcpsp_light_engine_test";
+
+// Chunks from -1 to 1 on both axes are generated
+static constexpr int MIN = -16;
+static constexpr int SIZE = 48;
+
+static const BlockState air;
+static const BlockState dirt{ResourceLocation("minecraft:dirt")};
+static const BlockState stone{ResourceLocation("minecraft:stone")};
+static const BlockState glowstone{ResourceLocation("test:glowstone")};
+static const BlockState torch{ResourceLocation("test:torch")};
+static const BlockState redstoneTorch{ResourceLocation("test:redstone_torch")};
+
+// In block units, as Model leaves elements once parsed
+static Model makeCube() {
+  ModelElement element;
+  element.from = {0, 0, 0};
+  element.to = {1, 1, 1};
+  for (const char *face : {"north", "south", "east", "west", "up", "down"}) {
+    element.faces[face] = {{0, 0}, {1, 1}, "test:block/cube", face};
+  }
+  return Model(std::vector<ModelElement>{element});
+}
+
+static void registerBlocks() {
+  for (const char *name :
+       {"minecraft:bedrock", "minecraft:dirt", "minecraft:grass_block",
+        "minecraft:stone"}) {
+    BlockRegistry::registerBlock(ResourceLocation(name), Block{makeCube()});
+  }
+  Block emitter;
+  emitter.model = makeCube();
+  emitter.lightEmission = 15;
+  BlockRegistry::registerBlock(glowstone.block, emitter);
+  // Torches have no elements, so light passes through them
+  emitter.model = Model();
+  emitter.lightEmission = 14;
+  BlockRegistry::registerBlock(torch.block, emitter);
+  emitter.lightEmission = 7;
+  BlockRegistry::registerBlock(redstoneTorch.block, emitter);
+}
+
+static const Chunk *getChunkAt(const World &world, int x, int z) {
+  return world.getChunk(x >> 4, z >> 4);
+}
+
+static bool isOpaque(const Chunk &chunk, int x, int y, int z) {
+  return BlockRegistry::getBlock(chunk.getBlock(x & 15, y, z & 15).block)
+      .bakedModel.isOpaque();
+}
+
+// Floods one channel through the loaded chunks, starting from every emitter
+// or every sky lit column, and counts the blocks whose light differs
+static int countMismatches(const World &world, LightChannel channel) {
+  std::vector<uint8_t> expected(SIZE * Chunk::HEIGHT * SIZE, 0);
+  auto at = [&](int x, int y, int z) -> uint8_t & {
+    return expected[((x - MIN) * Chunk::HEIGHT + y) * SIZE + z - MIN];
+  };
+
+  std::deque<std::array<int, 3>> queue;
+  for (int x = MIN; x < MIN + SIZE; ++x) {
+    for (int z = MIN; z < MIN + SIZE; ++z) {
+      const Chunk *chunk = getChunkAt(world, x, z);
+      if (chunk == nullptr) {
+        continue;
+      }
+      for (int y = Chunk::HEIGHT - 1; y >= 0; --y) {
+        uint8_t level = 0;
+        if (channel == LightChannel::Sky) {
+          if (isOpaque(*chunk, x, y, z)) {
+            break;
+          }
+          level = 15;
+        } else {
+          level = BlockRegistry::getBlock(
+                      chunk->getBlock(x & 15, y, z & 15).block)
+                      .lightEmission;
+        }
+        if (level > 0) {
+          at(x, y, z) = level;
+          queue.push_back({x, y, z});
+        }
+      }
+    }
+  }
+
+  while (!queue.empty()) {
+    auto [x, y, z] = queue.front();
+    queue.pop_front();
+    uint8_t level = at(x, y, z);
+    for (int face = 0; face < 6; ++face) {
+      Direction direction = static_cast<Direction>(face);
+      DirectionOffset offset = getOffset(direction);
+      int nx = x + offset.x, ny = y + offset.y, nz = z + offset.z;
+      if (ny < 0 || ny >= Chunk::HEIGHT || nx < MIN || nx >= MIN + SIZE ||
+          nz < MIN || nz >= MIN + SIZE) {
+        continue;
+      }
+      const Chunk *chunk = getChunkAt(world, nx, nz);
+      int next = channel == LightChannel::Sky &&
+                         direction == Direction::Down && level == 15
+                     ? 15
+                     : level - 1;
+      if (chunk == nullptr || next <= at(nx, ny, nz) ||
+          isOpaque(*chunk, nx, ny, nz)) {
+        continue;
+      }
+      at(nx, ny, nz) = next;
+      queue.push_back({nx, ny, nz});
+    }
+  }
+
+  int mismatches = 0;
+  for (int x = MIN; x < MIN + SIZE; ++x) {
+    for (int z = MIN; z < MIN + SIZE; ++z) {
+      const Chunk *chunk = getChunkAt(world, x, z);
+      for (int y = 0; y < Chunk::HEIGHT && chunk != nullptr; ++y) {
+        if (chunk->getLight(channel, x & 15, y, z & 15) != at(x, y, z)) {
+          ++mismatches;
+        }
+      }
+    }
+  }
+  return mismatches;
+}
+
+static bool matchesReference(const World &world) {
+  return countMismatches(world, LightChannel::Sky) == 0 &&
+         countMismatches(world, LightChannel::Block) == 0;
+}
+
+static void setBlock(World &world, int x, int y, int z,
+                     const BlockState &state) {
+  world.getChunk(x >> 4, z >> 4)->setBlock(x & 15, y, z & 15, state);
+}
+
+int main() {
+  registerBlocks();
+  std::filesystem::remove_all(directory);
+
+  World world(1);
+  world.setSaveDirectory(directory.string());
+  for (int z = -1; z <= 1; ++z) {
+    for (int x = -1; x <= 1; ++x) {
+      world.generateChunk(x, z);
+    }
+  }
+  CHECK(matchesReference(world));
+
+  // A cave under the surface, across the border of chunks (0, 0) and (1, 0)
+  for (int x = 8; x < 24; ++x) {
+    for (int z = 2; z < 12; ++z) {
+      for (int y = 2; y < 7; ++y) {
+        setBlock(world, x, y, z, air);
+      }
+    }
+  }
+  CHECK(matchesReference(world));
+
+  // Breaking a brighter emitter clears its light from a dimmer one next to
+  // it, which has to light its surroundings again
+  setBlock(world, 10, 3, 4, glowstone);
+  setBlock(world, 11, 3, 4, torch);
+  CHECK(matchesReference(world));
+  setBlock(world, 10, 3, 4, air);
+  CHECK(matchesReference(world));
+  setBlock(world, 12, 3, 4, redstoneTorch);
+  CHECK(matchesReference(world));
+  setBlock(world, 11, 3, 4, air);
+  CHECK(matchesReference(world));
+
+  // The same across a chunk border, through unloading and loading the
+  // chunk with the brighter emitter
+  setBlock(world, 15, 3, 8, glowstone);
+  setBlock(world, 16, 3, 8, torch);
+  setBlock(world, 17, 4, 8, redstoneTorch);
+  CHECK(matchesReference(world));
+  world.unloadChunk(0, 0);
+  CHECK(matchesReference(world));
+  CHECK(world.loadChunk(0, 0));
+  CHECK(matchesReference(world));
+  world.unloadChunk(1, 0);
+  CHECK(matchesReference(world));
+  CHECK(world.loadChunk(1, 0));
+  CHECK(matchesReference(world));
+
+  // A block in the dark changes no light, but the meshes of every section
+  // whose padding holds it still need rebuilding for culling and ambient
+  // occlusion. Queueing meshes on a worker that never runs clears the dirty
+  // flags generation left.
+  MeshWorker worker;
+  uint32_t nextTicket = 0;
+  for (int z = -1; z <= 1; ++z) {
+    for (int x = -1; x <= 1; ++x) {
+      int budget = Chunk::SECTION_COUNT;
+      world.getChunk(x, z)->queueMeshing(worker, nextTicket, budget);
+    }
+  }
+  CHECK(world.getChunk(0, 0)->getLight(LightChannel::Sky, 0, 16, 0) == 0);
+  CHECK(world.getChunk(0, 0)->getLight(LightChannel::Block, 0, 16, 0) == 0);
+  setBlock(world, 0, 16, 0, stone);
+  for (int z = -1; z <= 1; ++z) {
+    for (int x = -1; x <= 1; ++x) {
+      const Chunk *chunk = world.getChunk(x, z);
+      bool touched = x <= 0 && z <= 0;
+      for (int sectionY = 0; sectionY < Chunk::SECTION_COUNT; ++sectionY) {
+        CHECK(chunk->isSectionDirty(sectionY) ==
+              (touched && (sectionY == 0 || sectionY == 1)));
+      }
+    }
+  }
+  CHECK(matchesReference(world));
+
+  // Random edits of emitters and walls inside the cave
+  const BlockState states[] = {air, dirt, glowstone, torch, redstoneTorch};
+  std::mt19937 random(3);
+  for (int i = 0; i < 200; ++i) {
+    int x = 8 + random() % 16;
+    int y = 2 + random() % 5;
+    int z = 2 + random() % 10;
+    setBlock(world, x, y, z, states[random() % 5]);
+    if (i % 50 == 49) {
+      CHECK(matchesReference(world));
+    }
+  }
+
+  std::filesystem::remove_all(directory);
+  return MCPSP::Test::report();
+}
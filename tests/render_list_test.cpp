@@ -0,0 +1,148 @@
+// Submits render lists to the mock backend, checking how many state changes
+// and texture binds each draw order costs and that blended meshes are drawn
+// farthest first.
+#include "check.hpp"
+#include "render_list.hpp"
+#include <vector>
+
+using namespace MCPSP;
+
+// Also records which meshes were drawn, in order
+class RecordingBackend : public MockRenderBackend {
+public:
+  std::vector<const Mesh *> drawn;
+
+  void drawMesh(const Mesh &mesh) override {
+    MockRenderBackend::drawMesh(mesh);
+    drawn.push_back(&mesh);
+  }
+};
+
+struct TestItem {
+  uint8_t state;
+  TextureHandle texture;
+  float distance;
+};
+
+// Solid, cutout and blended items of three textures, added interleaved as
+// chunks would add them
+static const TestItem testItems[] = {
+    {0, 1, 5},
+    {RENDER_BLEND, 1, 9},
+    {RENDER_ALPHA_TEST, 3, 6},
+    {0, 2, 1},
+    {RENDER_BLEND, 2, 3},
+    {0, 1, 3},
+    {RENDER_ALPHA_TEST, 1, 7},
+    {0, 3, 4},
+    {RENDER_BLEND, 1, 12},
+    {0, 2, 2},
+    {RENDER_ALPHA_TEST, 3, 8},
+    {RENDER_BLEND, 2, 10},
+};
+static constexpr std::size_t TEST_ITEM_COUNT =
+    sizeof(testItems) / sizeof(testItems[0]);
+
+struct Submitted {
+  RenderList::SubmitStats stats;
+  RecordingBackend backend;
+  // The test items in the order they were drawn
+  std::vector<TestItem> order;
+};
+
+static Submitted submit(DrawOrder drawOrder, std::vector<Mesh> &meshes) {
+  RenderList list;
+  meshes.assign(TEST_ITEM_COUNT, Mesh());
+  for (std::size_t i = 0; i < TEST_ITEM_COUNT; ++i) {
+    meshes[i].vertices.resize((i + 1) * 4);
+    // Every item in its own section
+    list.add(testItems[i].state, testItems[i].texture, meshes[i],
+             {static_cast<float>(i) * 16, 0, 0}, testItems[i].distance);
+  }
+  list.sort(drawOrder);
+
+  Submitted result;
+  result.stats = list.submit(result.backend);
+  for (const Mesh *mesh : result.backend.drawn) {
+    result.order.push_back(testItems[mesh - meshes.data()]);
+  }
+  return result;
+}
+
+static void checkCommon(const Submitted &result) {
+  CHECK(result.stats.stateChanges == 3);
+  CHECK(result.backend.stateChanges == result.stats.stateChanges);
+  CHECK(result.backend.textureBinds == result.stats.textureBinds);
+  CHECK(result.stats.drawCalls == TEST_ITEM_COUNT);
+  CHECK(result.backend.drawCalls == TEST_ITEM_COUNT);
+  CHECK(result.backend.originChanges == TEST_ITEM_COUNT);
+  // 1 + 2 + ... + 12 quads
+  CHECK(result.backend.quadsDrawn == 78);
+  CHECK(result.order.size() == TEST_ITEM_COUNT);
+
+  // Solid, then cutout, then blended, the blended farthest first
+  for (std::size_t i = 1; i < result.order.size(); ++i) {
+    const TestItem &previous = result.order[i - 1];
+    const TestItem &item = result.order[i];
+    CHECK(previous.state <= item.state);
+    if (previous.state == RENDER_BLEND && item.state == RENDER_BLEND) {
+      CHECK(previous.distance > item.distance);
+    }
+  }
+}
+
+static void testByTexture() {
+  std::vector<Mesh> meshes;
+  Submitted result = submit(DrawOrder::ByTexture, meshes);
+  checkCommon(result);
+
+  // Solid binds textures 1, 2, 3, cutout 1, 3, and blended alternates
+  // 1, 2, 1, 2 by distance
+  CHECK(result.stats.textureBinds == 9);
+  for (std::size_t i = 1; i < result.order.size(); ++i) {
+    const TestItem &previous = result.order[i - 1];
+    const TestItem &item = result.order[i];
+    if (previous.state == item.state && item.state != RENDER_BLEND) {
+      CHECK(previous.texture <= item.texture);
+      if (previous.texture == item.texture) {
+        CHECK(previous.distance < item.distance);
+      }
+    }
+  }
+}
+
+static void testFrontToBack() {
+  std::vector<Mesh> meshes;
+  Submitted result = submit(DrawOrder::FrontToBack, meshes);
+  checkCommon(result);
+
+  // Solid binds 2, 1, 3, 1 by distance, cutout 3, 1, 3, and blended
+  // 1, 2, 1, 2 as before
+  CHECK(result.stats.textureBinds == 11);
+  for (std::size_t i = 1; i < result.order.size(); ++i) {
+    const TestItem &previous = result.order[i - 1];
+    const TestItem &item = result.order[i];
+    if (previous.state == item.state && item.state != RENDER_BLEND) {
+      CHECK(previous.distance < item.distance);
+    }
+  }
+}
+
+static void testEmpty() {
+  RenderList list;
+  RecordingBackend backend;
+  list.sort(DrawOrder::ByTexture);
+  RenderList::SubmitStats stats = list.submit(backend);
+  CHECK(stats.stateChanges == 0);
+  CHECK(stats.textureBinds == 0);
+  CHECK(stats.drawCalls == 0);
+  CHECK(backend.stateChanges == 0);
+  CHECK(backend.drawCalls == 0);
+}
+
+int main() {
+  testByTexture();
+  testFrontToBack();
+  testEmpty();
+  return MCPSP::Test::report();
+}
@@ -0,0 +1,147 @@
+// Converts images to CLUT4 and CLUT8 and back, checking which come through
+// unchanged and how the indices are packed.
+#include "check.hpp"
+#include "texture_quantizer.hpp"
+#include <vector>
+
+using namespace MCPSP;
+
+static bool sameColor(Color a, Color b) {
+  return a.r == b.r && a.g == b.g && a.b == b.b && a.a == b.a;
+}
+
+// Distinct colours that aren't fully transparent
+static std::vector<Color> makeColors(int count) {
+  std::vector<Color> colors;
+  for (int i = 0; i < count; ++i) {
+    colors.push_back({static_cast<unsigned char>(i * 7),
+                      static_cast<unsigned char>(255 - i % 256),
+                      static_cast<unsigned char>(i / 256 * 64 + i % 13),
+                      static_cast<unsigned char>(i % 2 == 0 ? 255 : 128)});
+  }
+  return colors;
+}
+
+static bool sameImage(const IndexedImage &image,
+                      const std::vector<Color> &pixels) {
+  for (int y = 0; y < image.height; ++y) {
+    for (int x = 0; x < image.width; ++x) {
+      if (!sameColor(image.getPixel(x, y), pixels[y * image.width + x])) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+static void testExactRoundTrip() {
+  // 16 colours fit CLUT4, spread over the image so neighbours differ
+  std::vector<Color> colors = makeColors(16);
+  std::vector<Color> pixels(16 * 8);
+  for (std::size_t i = 0; i < pixels.size(); ++i) {
+    pixels[i] = colors[i * 5 % colors.size()];
+  }
+  IndexedImage clut4 = quantizeImage(pixels.data(), 16, 8);
+  CHECK(clut4.format == ClutFormat::Clut4);
+  CHECK(clut4.exact);
+  CHECK(clut4.palette.size() == 16);
+  CHECK(clut4.indices.size() == pixels.size() / 2);
+  CHECK(sameImage(clut4, pixels));
+
+  // One more colour needs CLUT8
+  colors = makeColors(17);
+  pixels.resize(16 * 16);
+  for (std::size_t i = 0; i < pixels.size(); ++i) {
+    pixels[i] = colors[i % colors.size()];
+  }
+  IndexedImage clut8 = quantizeImage(pixels.data(), 16, 16);
+  CHECK(clut8.format == ClutFormat::Clut8);
+  CHECK(clut8.exact);
+  CHECK(clut8.palette.size() == 256);
+  CHECK(clut8.indices.size() == pixels.size());
+  CHECK(sameImage(clut8, pixels));
+
+  colors = makeColors(256);
+  for (std::size_t i = 0; i < pixels.size(); ++i) {
+    pixels[i] = colors[i];
+  }
+  IndexedImage full = quantizeImage(pixels.data(), 16, 16);
+  CHECK(full.exact);
+  CHECK(sameImage(full, pixels));
+
+  // Past 256 colours some have to be merged
+  pixels.resize(32 * 16);
+  colors = makeColors(300);
+  for (std::size_t i = 0; i < pixels.size(); ++i) {
+    pixels[i] = colors[i % colors.size()];
+  }
+  IndexedImage reduced = quantizeImage(pixels.data(), 32, 16);
+  CHECK(reduced.format == ClutFormat::Clut8);
+  CHECK(!reduced.exact);
+}
+
+static void testClut4NibbleOrder() {
+  IndexedImage image;
+  image.width = 4;
+  image.height = 2;
+  image.format = ClutFormat::Clut4;
+  image.indices = {0x21, 0x43, 0x65, 0x87};
+  for (int i = 0; i < 8; ++i) {
+    CHECK(image.getIndex(i % 4, i / 4) == i + 1);
+  }
+
+  // applyPalette packs the left pixel of each pair into the low nibble
+  std::vector<Color> palette = makeColors(4);
+  std::vector<Color> pixels = {palette[1], palette[2], palette[3], palette[0]};
+  IndexedImage packed = applyPalette(pixels.data(), 4, 1, palette);
+  CHECK(packed.indices.size() == 2);
+  CHECK(packed.indices[0] == 0x21);
+  CHECK(packed.indices[1] == 0x03);
+
+  // An odd width carries pairs on across rows
+  pixels = {palette[1], palette[2], palette[3],
+            palette[0], palette[3], palette[2]};
+  packed = applyPalette(pixels.data(), 3, 2, palette);
+  CHECK(packed.indices.size() == 3);
+  CHECK(packed.getIndex(0, 1) == 0);
+  CHECK(packed.getIndex(1, 1) == 3);
+  CHECK(packed.getIndex(2, 1) == 2);
+}
+
+static void testTransparentPixelsMerge() {
+  // 15 opaque colours and transparent pixels of every colour still fit
+  // CLUT4, since the alpha test sees all of those as the same
+  std::vector<Color> colors = makeColors(15);
+  std::vector<Color> pixels;
+  for (int i = 0; i < 64; ++i) {
+    if (i % 4 == 0) {
+      pixels.push_back({static_cast<unsigned char>(i * 3),
+                        static_cast<unsigned char>(i), 40, 0});
+    } else {
+      pixels.push_back(colors[i % colors.size()]);
+    }
+  }
+  std::vector<Color> palette = buildPalette(pixels.data(), pixels.size(), 256);
+  CHECK(palette.size() == 16);
+
+  IndexedImage image = quantizeImage(pixels.data(), 8, 8);
+  CHECK(image.format == ClutFormat::Clut4);
+  CHECK(image.exact);
+  int transparentIndex = image.getIndex(0, 0);
+  for (int i = 0; i < 64; ++i) {
+    int index = image.getIndex(i % 8, i / 8);
+    if (i % 4 == 0) {
+      CHECK(index == transparentIndex);
+      CHECK(image.palette[index].a == 0);
+    } else {
+      CHECK(sameColor(image.palette[index], pixels[i]));
+    }
+  }
+}
+
+int main() {
+  testExactRoundTrip();
+  testClut4NibbleOrder();
+  testTransparentPixelsMerge();
+  return MCPSP::Test::report();
+}
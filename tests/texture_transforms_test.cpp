@@ -0,0 +1,182 @@
+// Checks mip chains against a plain box filter, both for whole images and
+// for atlas pages whose tiles must never bleed into each other.
+#include "check.hpp"
+#include "texture_transforms.hpp"
+#include <algorithm>
+#include <random>
+#include <vector>
+
+using namespace MCPSP;
+
+static bool sameColor(Color a, Color b) {
+  return a.r == b.r && a.g == b.g && a.b == b.b && a.a == b.a;
+}
+
+static std::vector<Color> randomPixels(int width, int height, unsigned seed) {
+  std::mt19937 random(seed);
+  std::vector<Color> pixels(static_cast<std::size_t>(width) * height);
+  for (Color &pixel : pixels) {
+    pixel = {static_cast<unsigned char>(random()),
+             static_cast<unsigned char>(random()),
+             static_cast<unsigned char>(random()),
+             // Plenty of fully transparent and fully opaque texels
+             static_cast<unsigned char>(random() % 3 == 0   ? 0
+                                        : random() % 2 == 0 ? 255
+                                                            : random())};
+  }
+  return pixels;
+}
+
+// One level of a 2x2 box filter, averaging colour weighted by alpha and
+// rounding to nearest
+static std::vector<Color> halve(const std::vector<Color> &pixels, int width,
+                                int height) {
+  std::vector<Color> out(static_cast<std::size_t>(width / 2) * (height / 2));
+  for (int y = 0; y < height / 2; ++y) {
+    for (int x = 0; x < width / 2; ++x) {
+      unsigned r = 0, g = 0, b = 0, a = 0;
+      for (int dy = 0; dy < 2; ++dy) {
+        for (int dx = 0; dx < 2; ++dx) {
+          Color c = pixels[(y * 2 + dy) * width + x * 2 + dx];
+          r += c.r * c.a;
+          g += c.g * c.a;
+          b += c.b * c.a;
+          a += c.a;
+        }
+      }
+      Color &result = out[y * (width / 2) + x];
+      if (a == 0) {
+        result = {0, 0, 0, 0};
+      } else {
+        result = {static_cast<unsigned char>((r + a / 2) / a),
+                  static_cast<unsigned char>((g + a / 2) / a),
+                  static_cast<unsigned char>((b + a / 2) / a),
+                  static_cast<unsigned char>((a + 2) / 4)};
+      }
+    }
+  }
+  return out;
+}
+
+static void testBoxFilter() {
+  int width = 32, height = 16;
+  std::vector<Color> pixels = randomPixels(width, height, 1);
+  std::vector<MipLevel> levels = buildMipChain(pixels.data(), width, height, 4);
+  CHECK(levels.size() == 4);
+
+  std::vector<Color> expected = pixels;
+  for (const MipLevel &level : levels) {
+    expected = halve(expected, width, height);
+    width /= 2;
+    height /= 2;
+    CHECK(level.width == width);
+    CHECK(level.height == height);
+    CHECK(std::equal(level.pixels.begin(), level.pixels.end(),
+                     expected.begin(), sameColor));
+  }
+
+  // Transparent texels don't pull the colour of their neighbours down
+  std::vector<Color> cutout = {{200, 100, 50, 255},
+                               {0, 0, 0, 0},
+                               {200, 100, 50, 255},
+                               {200, 100, 50, 255}};
+  std::vector<MipLevel> cutoutLevels = buildMipChain(cutout.data(), 2, 2, 1);
+  CHECK(sameColor(cutoutLevels[0].pixels[0], {200, 100, 50, 191}));
+
+  CHECK_THROWS(buildMipChain(pixels.data(), 6, 4, 2));
+}
+
+// Fills a tile's padding with copies of its edge texels, as the atlas does
+static void padTile(std::vector<Color> &pixels, int width,
+                    const MipTile &tile) {
+  for (int y = tile.y - tile.padding; y < tile.y + tile.height + tile.padding;
+       ++y) {
+    for (int x = tile.x - tile.padding;
+         x < tile.x + tile.width + tile.padding; ++x) {
+      int sx = std::clamp(x, tile.x, tile.x + tile.width - 1);
+      int sy = std::clamp(y, tile.y, tile.y + tile.height - 1);
+      pixels[y * width + x] = pixels[sy * width + sx];
+    }
+  }
+}
+
+static void testTileIsolation() {
+  // Four 8x8 tiles with 4 texels of padding, packed edge to edge like the
+  // atlas packs them
+  int size = 32;
+  std::vector<Color> pixels = randomPixels(size, size, 2);
+  std::vector<MipTile> tiles;
+  for (int cellY = 0; cellY < size; cellY += 16) {
+    for (int cellX = 0; cellX < size; cellX += 16) {
+      tiles.push_back({cellX + 4, cellY + 4, 8, 8, 4});
+      padTile(pixels, size, tiles.back());
+    }
+  }
+
+  int levelCount = getMipLevelCount(size, size, tiles, 7);
+  CHECK(levelCount == 2);
+  std::vector<MipLevel> levels =
+      buildMipChain(pixels.data(), size, size, levelCount, tiles);
+
+  // Every tile's levels match filtering the tile on its own, padding
+  // included, so nothing from a neighbouring tile gets in
+  for (const MipTile &tile : tiles) {
+    std::vector<Color> expected;
+    for (int y = tile.y; y < tile.y + tile.height; ++y) {
+      for (int x = tile.x; x < tile.x + tile.width; ++x) {
+        expected.push_back(pixels[y * size + x]);
+      }
+    }
+
+    int tileSize = tile.width;
+    for (int level = 1; level <= levelCount; ++level) {
+      expected = halve(expected, tileSize, tileSize);
+      tileSize /= 2;
+      const MipLevel &mip = levels[level - 1];
+      int x0 = tile.x >> level, y0 = tile.y >> level;
+      int padding = tile.padding >> level;
+      for (int y = -padding; y < tileSize + padding; ++y) {
+        for (int x = -padding; x < tileSize + padding; ++x) {
+          Color actual = mip.pixels[(y0 + y) * mip.width + x0 + x];
+          int sx = std::clamp(x, 0, tileSize - 1);
+          int sy = std::clamp(y, 0, tileSize - 1);
+          CHECK(sameColor(actual, expected[sy * tileSize + sx]));
+        }
+      }
+    }
+  }
+}
+
+static void testMipLevelCount() {
+  // Without tiles only the image size and the cap matter
+  CHECK(getMipLevelCount(256, 256, {}, 7) == 7);
+  CHECK(getMipLevelCount(256, 256, {}, 3) == 3);
+  CHECK(getMipLevelCount(64, 32, {}, 7) == 5);
+  CHECK(getMipLevelCount(6, 6, {}, 7) == 1);
+
+  // Atlas tiles of 16 texels with 4 of padding sit at 4, 28, 52, ..., so the
+  // third level would put their padding and offsets on half texels
+  std::vector<MipTile> atlas;
+  for (int i = 0; i < 10; ++i) {
+    atlas.push_back({4 + (i % 5) * 24, 4 + (i / 5) * 24, 16, 16, 4});
+  }
+  CHECK(getMipLevelCount(256, 256, atlas, 7) == 2);
+  CHECK(getMipLevelCount(256, 256, atlas, 1) == 1);
+
+  // More padding lets levels go further
+  CHECK(getMipLevelCount(256, 256, {{8, 8, 16, 16, 8}}, 7) == 3);
+  // Unpadded tiles are only limited by their position and size
+  CHECK(getMipLevelCount(256, 256, {{0, 0, 16, 16, 0}}, 7) == 4);
+  CHECK(getMipLevelCount(256, 256, {{32, 0, 16, 16, 0}}, 7) == 4);
+  // A tile that doesn't halve evenly, or sits on an odd texel
+  CHECK(getMipLevelCount(256, 256, {{4, 4, 12, 16, 4}}, 7) == 2);
+  CHECK(getMipLevelCount(256, 256, {{4, 4, 10, 16, 4}}, 7) == 1);
+  CHECK(getMipLevelCount(256, 256, {{3, 4, 16, 16, 4}}, 7) == 0);
+}
+
+int main() {
+  testBoxFilter();
+  testTileIsolation();
+  testMipLevelCount();
+  return MCPSP::Test::report();
+}
@@ -0,0 +1,130 @@
+// Schedules ticks across every level of the timing wheel and the overflow
+// list, checking each one runs on exactly the tick it came due.
+#include "check.hpp"
+#include "tick_scheduler.hpp"
+#include <vector>
+
+using namespace MCPSP;
+
+// The tick's index doubles as an id for telling ticks apart
+static ScheduledTick makeTick(int id, ChunkPosition chunk = {0, 0}) {
+  return {chunk, static_cast<uint16_t>(id)};
+}
+
+// Delays on either side of where each level and the overflow list take over
+static const uint32_t delays[] = {
+    1,        2,        63,       64,       65,       127,      4095,
+    4096,     4097,     262143,   262144,   262145,   16777215, 16777216,
+    16777217, 20000000,
+};
+static constexpr int DELAY_COUNT = sizeof(delays) / sizeof(delays[0]);
+
+static void testDelays(uint64_t start) {
+  TickScheduler scheduler;
+  std::vector<ScheduledTick> ready;
+  while (scheduler.getCurrentTick() < start) {
+    scheduler.advance();
+  }
+
+  for (int i = 0; i < DELAY_COUNT; ++i) {
+    scheduler.schedule(makeTick(i), delays[i]);
+  }
+  CHECK(scheduler.getScheduledCount() == DELAY_COUNT);
+
+  std::vector<uint64_t> ranAt(DELAY_COUNT, 0);
+  uint64_t last = start + delays[DELAY_COUNT - 1];
+  while (scheduler.getCurrentTick() < last) {
+    scheduler.advance();
+    ready.clear();
+    scheduler.takeReady(ready, DELAY_COUNT);
+    for (const ScheduledTick &tick : ready) {
+      CHECK(ranAt[tick.index] == 0);
+      ranAt[tick.index] = scheduler.getCurrentTick();
+    }
+  }
+
+  for (int i = 0; i < DELAY_COUNT; ++i) {
+    CHECK(ranAt[i] == start + delays[i]);
+  }
+  CHECK(scheduler.getScheduledCount() == 0);
+  CHECK(scheduler.getReadyCount() == 0);
+}
+
+static void testStaleHandles() {
+  TickScheduler scheduler;
+  std::vector<ScheduledTick> ready;
+
+  TickHandle first = scheduler.schedule(makeTick(1), 5);
+  CHECK(scheduler.cancel(first));
+  CHECK(!scheduler.cancel(first));
+  CHECK(scheduler.getScheduledCount() == 0);
+
+  // The cancelled entry is reused, and the old handle must not cancel the
+  // tick now in it
+  TickHandle second = scheduler.schedule(makeTick(2), 5);
+  CHECK(second.index == first.index);
+  CHECK(!scheduler.cancel(first));
+  CHECK(scheduler.getScheduledCount() == 1);
+
+  for (int i = 0; i < 5; ++i) {
+    scheduler.advance();
+  }
+  scheduler.takeReady(ready, 10);
+  CHECK(ready.size() == 1 && ready[0].index == 2);
+
+  // Nor does a handle to a tick that already ran, once its entry is reused
+  TickHandle third = scheduler.schedule(makeTick(3), 1);
+  CHECK(third.index == second.index);
+  CHECK(!scheduler.cancel(second));
+  CHECK(scheduler.cancel(third));
+  CHECK(scheduler.getScheduledCount() == 0);
+
+  CHECK(!scheduler.cancel(TickHandle()));
+}
+
+static void testBudget() {
+  TickScheduler scheduler;
+  std::vector<ScheduledTick> ready;
+
+  // Ticks of two chunks, interleaved
+  for (int i = 0; i < 10; ++i) {
+    scheduler.schedule(makeTick(i, {i % 2 == 0 ? 1 : 0, 0}), 0);
+  }
+  CHECK(scheduler.getReadyCount() == 10);
+
+  scheduler.takeReady(ready, 0);
+  CHECK(ready.empty());
+
+  // The three oldest, grouped by chunk but in order within each
+  scheduler.takeReady(ready, 3);
+  CHECK(ready.size() == 3 && ready[0].index == 1 && ready[1].index == 0 &&
+        ready[2].index == 2);
+  CHECK(scheduler.getReadyCount() == 7);
+  CHECK(scheduler.getScheduledCount() == 7);
+
+  // What's left stays ready through later game ticks
+  scheduler.advance();
+  ready.clear();
+  scheduler.takeReady(ready, 100);
+  CHECK(ready.size() == 7);
+  for (std::size_t i = 1; i < ready.size(); ++i) {
+    const ScheduledTick &previous = ready[i - 1];
+    const ScheduledTick &tick = ready[i];
+    CHECK(previous.chunk.x <= tick.chunk.x);
+    if (previous.chunk.x == tick.chunk.x) {
+      CHECK(previous.index < tick.index);
+    }
+  }
+  CHECK(scheduler.getReadyCount() == 0);
+}
+
+int main() {
+  // From the start, and from ticks just short of and on level boundaries
+  testDelays(0);
+  testDelays(37);
+  testDelays(4090);
+  testDelays(262144);
+  testStaleHandles();
+  testBudget();
+  return MCPSP::Test::report();
+}
@@ -0,0 +1,172 @@
+// Compiles block models from an extracted Minecraft assets tree into the
+// binary bundle loaded by BlockRegistry::registerBundle.
+//
+// Usage: asset_compiler [--verify] <assets dir> <output> [block...]
+//
+// Blocks are given as IDs such as "minecraft:dirt"; with none given, every
+// blockstate in the assets tree is compiled. Each block uses the model of
+// the first variant in its blockstate. --verify reads the bundle back and
+// checks every model against the one loaded from JSON.
+#include "asset_bundle.hpp"
+#include "direction.hpp"
+#include "model.hpp"
+#include "resource_location.hpp"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <nlohmann/json.hpp>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace MCPSP;
+
+// Model of the first variant, or of the first multipart case
+static std::string getBlockModel(const ResourceLocation &block) {
+  std::string path = block.resolvePath("blockstates") + ".json";
+  std::ifstream file(path);
+  if (!file.is_open()) {
+    throw std::runtime_error("failed to open blockstate file: " + path);
+  }
+  nlohmann::json json = nlohmann::json::parse(file);
+
+  nlohmann::json apply;
+  if (json.contains("variants") && !json["variants"].empty()) {
+    apply = json["variants"].begin().value();
+  } else if (json.contains("multipart") && !json["multipart"].empty()) {
+    apply = json["multipart"][0]["apply"];
+  } else {
+    throw std::runtime_error("blockstate has no models: " + path);
+  }
+  if (apply.is_array()) {
+    apply = apply[0];
+  }
+  return apply["model"].get<std::string>();
+}
+
+static std::vector<std::string> findBlocks(const std::string &assets) {
+  std::vector<std::string> blocks;
+  for (const auto &ns : std::filesystem::directory_iterator(assets)) {
+    std::filesystem::path states = ns.path() / "blockstates";
+    if (!std::filesystem::is_directory(states)) {
+      continue;
+    }
+    for (const auto &file : std::filesystem::directory_iterator(states)) {
+      if (file.path().extension() == ".json") {
+        blocks.push_back(ns.path().filename().string() + ":" +
+                         file.path().stem().string());
+      }
+    }
+  }
+  std::sort(blocks.begin(), blocks.end());
+  return blocks;
+}
+
+static bool equal(Vector2 a, Vector2 b) { return a.x == b.x && a.y == b.y; }
+
+static bool equal(Vector3 a, Vector3 b) {
+  return a.x == b.x && a.y == b.y && a.z == b.z;
+}
+
+static bool equal(const Model &a, const Model &b) {
+  const std::vector<ModelElement> &ea = a.getElements();
+  const std::vector<ModelElement> &eb = b.getElements();
+  if (ea.size() != eb.size()) {
+    return false;
+  }
+  for (std::size_t i = 0; i < ea.size(); ++i) {
+    if (!equal(ea[i].from, eb[i].from) || !equal(ea[i].to, eb[i].to) ||
+        !equal(ea[i].rotation.origin, eb[i].rotation.origin) ||
+        ea[i].rotation.axis != eb[i].rotation.axis ||
+        ea[i].rotation.angle != eb[i].rotation.angle ||
+        ea[i].faces.size() != eb[i].faces.size()) {
+      return false;
+    }
+    for (const auto &[direction, fa] : ea[i].faces) {
+      auto it = eb[i].faces.find(direction);
+      if (it == eb[i].faces.end()) {
+        return false;
+      }
+      const ModelFace &fb = it->second;
+      if (!equal(fa.uv1, fb.uv1) || !equal(fa.uv2, fb.uv2) ||
+          a.resolveTexture(fa.texture) != b.resolveTexture(fb.texture) ||
+          parseDirection(fa.cullface) != parseDirection(fb.cullface) ||
+          fa.rotation != fb.rotation || fa.tintindex != fb.tintindex) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+int main(int argc, char *argv[]) {
+  std::vector<std::string> args(argv + 1, argv + argc);
+  bool verify = !args.empty() && args[0] == "--verify";
+  if (verify) {
+    args.erase(args.begin());
+  }
+  if (args.size() < 2) {
+    std::cerr << "usage: asset_compiler [--verify] <assets dir> <output> "
+                 "[block...]"
+              << std::endl;
+    return 1;
+  }
+
+  ResourceLocation::setAssetRoot(args[0]);
+  std::string output = args[1];
+  std::vector<std::string> blocks(args.begin() + 2, args.end());
+  if (blocks.empty()) {
+    blocks = findBlocks(args[0]);
+  }
+
+  AssetBundle bundle;
+  std::unordered_map<ResourceLocation, std::size_t> modelIndices;
+  std::vector<ResourceLocation> modelLocations;
+  int failed = 0;
+  for (const std::string &block : blocks) {
+    try {
+      ResourceLocation model(getBlockModel(ResourceLocation(block)));
+      auto it = modelIndices.find(model);
+      if (it == modelIndices.end()) {
+        bundle.models.push_back(AssetBundle::flatten(*Model::get(model)));
+        modelLocations.push_back(model);
+        it = modelIndices.emplace(model, bundle.models.size() - 1).first;
+      }
+      bundle.blocks.push_back({block, it->second});
+    } catch (const std::exception &e) {
+      std::cerr << "Skipping " << block << ": " << e.what() << std::endl;
+      ++failed;
+    }
+  }
+
+  bundle.write(output);
+  std::cout << "Wrote " << bundle.blocks.size() << " blocks and "
+            << bundle.models.size() << " models to " << output << " ("
+            << std::filesystem::file_size(output) << " bytes, "
+            << Model::getFileOpenCount() << " model files read)" << std::endl;
+
+  if (verify) {
+    AssetBundle loaded = AssetBundle::read(output);
+    int mismatched = 0;
+    if (loaded.blocks.size() != bundle.blocks.size()) {
+      std::cerr << "Block count differs" << std::endl;
+      ++mismatched;
+    }
+    for (std::size_t i = 0; i < loaded.blocks.size(); ++i) {
+      const AssetBundle::BlockEntry &entry = loaded.blocks[i];
+      const Model &json = *Model::get(modelLocations[entry.model]);
+      if (entry.block != bundle.blocks[i].block ||
+          !equal(json, loaded.models[entry.model])) {
+        std::cerr << "Mismatch: " << entry.block << std::endl;
+        ++mismatched;
+      }
+    }
+    std::cout << "Verified " << loaded.blocks.size() << " blocks, "
+              << mismatched << " mismatched" << std::endl;
+    if (mismatched > 0) {
+      return 1;
+    }
+  }
+  return failed > 0 ? 2 : 0;
+}